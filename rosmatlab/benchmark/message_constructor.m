@@ -0,0 +1,21 @@
+% Message constructor calls per second (needs the messages of rosmatlab_common_msgs).
+
+duration = 2.0;
+
+fprintf('%-40s %14s\n', 'call', 'calls/s');
+
+calls = 0; tic;
+while toc < duration; geometry_msgs.Point(); calls = calls + 1; end
+fprintf('%-40s %14.0f\n', 'geometry_msgs.Point()', calls / toc);
+
+calls = 0; tic;
+while toc < duration; geometry_msgs.Point(struct('x', 1, 'y', 2, 'z', 3)); calls = calls + 1; end
+fprintf('%-40s %14.0f\n', 'geometry_msgs.Point(struct)', calls / toc);
+
+calls = 0; tic;
+while toc < duration; geometry_msgs.PoseStamped(); calls = calls + 1; end
+fprintf('%-40s %14.0f\n', 'geometry_msgs.PoseStamped()', calls / toc);
+
+calls = 0; tic;
+while toc < duration; geometry_msgs.Point(1000); calls = calls + 1; end
+fprintf('%-40s %14.0f\n', 'geometry_msgs.Point(1000)', calls / toc);
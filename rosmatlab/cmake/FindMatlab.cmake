@@ -5,6 +5,7 @@
 #  MATLAB_MEX_LIBRARY:      path to libmex.lib
 #  MATLAB_MX_LIBRARY:       path to libmx.lib
 #  MATLAB_ENG_LIBRARY:      path to libeng.lib
+#  MATLAB_MAT_LIBRARY:      path to libmat.lib
 #  MATLAB_MEX_VERSION_FILE: path to mexversion.rc or mexversion.c
 #  MATLAB_MEX_SUFFIX:       filename suffix for mex-files (e.g. '.mexglx' or '.mexw64')
 #  MATLAB_ROOT:             path to the Matlab root
@@ -59,6 +60,7 @@ IF(WIN32)
   SET(_libmex_name "libmex")
   SET(_libmx_name "libmx")
   SET(_libeng_name "libeng")
+  SET(_libmat_name "libmat")
 
 ELSE(WIN32)
 
@@ -78,6 +80,7 @@ ELSE(WIN32)
   SET(_libmex_name "mex")
   SET(_libmx_name "mx")
   SET(_libeng_name "eng")
+  SET(_libmat_name "mat")
 ENDIF(WIN32)
 
 SET(_matlab_path_prefixes
@@ -113,6 +116,7 @@ FOREACH(_matlab_prefix ${_matlab_path_prefixes})
           FIND_LIBRARY(MATLAB_MEX_LIBRARY ${_libmex_name} PATHS ${_matlab_libdir} NO_DEFAULT_PATH)
           FIND_LIBRARY(MATLAB_MX_LIBRARY ${_libmx_name} PATHS ${_matlab_libdir} NO_DEFAULT_PATH)
           FIND_LIBRARY(MATLAB_ENG_LIBRARY ${_libeng_name} PATHS ${_matlab_libdir} NO_DEFAULT_PATH)
+          FIND_LIBRARY(MATLAB_MAT_LIBRARY ${_libmat_name} PATHS ${_matlab_libdir} NO_DEFAULT_PATH)
 
           IF(MATLAB_MEX_LIBRARY)
             MESSAGE(STATUS "Found Matlab libraries in ${_matlab_libdir}")
@@ -140,6 +144,7 @@ MARK_AS_ADVANCED(
   MATLAB_MEX_LIBRARY
   MATLAB_MX_LIBRARY
   MATLAB_ENG_LIBRARY
+  MATLAB_MAT_LIBRARY
   MATLAB_INCLUDE_DIR
   MATLAB_MEX_SUFFIX
   MATLAB_MEX_VERSIONFILE
@@ -35,10 +35,15 @@
 #include <boost/shared_ptr.hpp>
 #include <boost/function.hpp>
 #include <boost/type_traits.hpp>
+#include <boost/unordered_set.hpp>
 
 #include "mex.h"
 
 #include <stdint.h>
+#include <cmath>
+#include <limits>
+#include <map>
+#include <vector>
 
 namespace rosmatlab {
 
@@ -46,6 +51,13 @@ namespace {
   struct null_deleter {
     void operator()(void const *) const {}
   };
+
+  // casts value to an unsigned integer type, fails for negative, fractional, non-finite or too large values
+  template <typename T> inline bool unsignedValue(double value, T &result) {
+    if (!(value >= 0) || std::floor(value) != value || value >= std::ldexp(1.0, std::numeric_limits<T>::digits)) return false;
+    result = static_cast<T>(value);
+    return true;
+  }
 }
 
 template <class Type>
@@ -58,7 +70,7 @@ public:
   Object(Type *instance) { *this = instance; construct(); }
   Object(const Ptr &instance) { *this = instance; construct(); }
   Object(const Object &other) { *this = other; construct(); }
-  virtual ~Object() { if (handle_) mxDestroyArray(handle_); }
+  virtual ~Object() { registry().erase(this); if (handle_) mxDestroyArray(handle_); }
 
   const Ptr &instance() const { return instance_; }
   mxArray *handle() const { return handle_; }
@@ -82,22 +94,30 @@ public:
   }
 
   static Object<Type> *byHandle(const mxArray *handle) {
-    const mxArray *ptr = 0;
+    uint64_t value = 0;
     if (!handle) return 0;
     // mexPrintf(ROSMATLAB_PRINTF_PREFIX "Searching for object of type %s (%s)...\n", getClassName(), typeid(Type).name());
     if (mxIsClass(handle, class_name_)) {
       // mexPrintf(ROSMATLAB_PRINTF_PREFIX "Handle is a %s class\n", mxGetClassName(handle));
-      ptr = mxGetProperty(handle, 0, "handle");
+      // mxGetProperty returns a copy of the property
+      mxArray *property = mxGetProperty(handle, 0, "handle");
+      bool valid = handleValue(property, value);
+      if (property) mxDestroyArray(property);
+      if (!valid) throw Exception("invalid handle");
     } else if (mxIsStruct(handle)) {
       // mexPrintf(ROSMATLAB_PRINTF_PREFIX "Handle is a struct\n");
-      ptr = mxGetField(handle, 0, "handle");
-    } else if (mxIsDouble(handle)) {
-      // mexPrintf(ROSMATLAB_PRINTF_PREFIX "Handle is a double\n");
-      ptr = handle;
+      if (!handleValue(mxGetField(handle, 0, "handle"), value)) throw Exception("invalid handle");
+    } else if (mxIsNumeric(handle)) {
+      // the Matlab classes pass their uint64 handle directly
+      if (!handleValue(handle, value)) throw Exception("invalid handle");
+    } else {
+      // objects of other classes (e.g. a Bag where a View is expected)
+      return 0;
     }
-    if (!ptr || !mxIsDouble(ptr) || !(mxGetNumberOfElements(ptr) > 0) || !mxGetPr(ptr)) throw Exception("invalid handle");
+    if (!value) return 0;
 
-    Object<Type> *object = reinterpret_cast<Object<Type> *>(static_cast<uint64_t>(*mxGetPr(ptr)));
+    Object<Type> *object = reinterpret_cast<Object<Type> *>(value);
+    if (!registry().count(object)) throw Exception("invalid handle");
     return object;
   }
 
@@ -109,10 +129,25 @@ private:
   static const char *class_name_;
 
   void construct() {
-    handle_ = mxCreateDoubleScalar(reinterpret_cast<uint64_t>(this));
+    handle_ = mxCreateNumericMatrix(1, 1, mxUINT64_CLASS, mxREAL);
+    *static_cast<uint64_t *>(mxGetData(handle_)) = reinterpret_cast<uint64_t>(this);
     mexMakeArrayPersistent(handle_);
+    registry().insert(this);
     assert(byHandle(handle()) == this);
   }
+
+  // live objects of this type, handles passed from Matlab are only dereferenced if they are found here
+  static boost::unordered_set<const Object<Type> *> &registry() {
+    static boost::unordered_set<const Object<Type> *> objects;
+    return objects;
+  }
+
+  static bool handleValue(const mxArray *ptr, uint64_t &value) {
+    if (!ptr || mxGetNumberOfElements(ptr) != 1) return false;
+    if (mxIsUint64(ptr)) { value = *static_cast<const uint64_t *>(mxGetData(ptr)); return true; }
+    if (mxIsDouble(ptr)) return unsignedValue(mxGetScalar(ptr), value);
+    return false;
+  }
 };
 
 template <class Type>
@@ -212,7 +247,11 @@ private:
 //  std::map<std::string,FunctionType5> methods5_;
 //  std::map<std::string,FunctionType6> methods6_;
 
-  std::map<std::string,boost::function<void(Type *, int, mxArray *[], int, const mxArray *[])> > methods_;
+  typedef boost::function<void(Type *, int, mxArray *[], int, const mxArray *[])> FunctionType;
+
+  // methods are numbered in the order they are added, Matlab classes cache these ids to skip the string lookup
+  std::map<std::string,std::size_t> ids_;
+  std::vector<FunctionType> methods_;
 
   bool initialized_;
   bool throw_on_unknown_;
@@ -232,6 +271,17 @@ public:
     return initialized_;
   }
 
+  MexMethodMap &set(const std::string& name, const FunctionType& function) {
+    typename std::map<std::string,std::size_t>::iterator found = ids_.find(name);
+    if (found != ids_.end()) {
+      methods_[found->second] = function;
+    } else {
+      ids_[name] = methods_.size();
+      methods_.push_back(function);
+    }
+    return *this;
+  }
+
   MexMethodMap &throwOnUnknown(bool value = true) {
     throw_on_unknown_ = value;
     return *this;
@@ -239,37 +289,37 @@ public:
 
   template <typename Result>
   MexMethodMap &add(const std::string& name, Result (Type::*function)(int nlhs, mxArray *plhs[], int nrhs, const mxArray *prhs[])) {
-    methods_[name] = internal::MexFunctor<Result (Type *, int nlhs, mxArray *plhs[], int nrhs, const mxArray *prhs[])>(function);
+    set(name, internal::MexFunctor<Result (Type *, int nlhs, mxArray *plhs[], int nrhs, const mxArray *prhs[])>(function));
     return *this;
   }
 
   template <typename Result>
   MexMethodMap &add(const std::string& name, Result (Type::*function)(int nlhs, mxArray *plhs[], int nrhs, const mxArray *prhs[]) const) {
-    methods_[name] = internal::MexFunctor<Result (const Type *, int nlhs, mxArray *plhs[], int nrhs, const mxArray *prhs[])>(function);
+    set(name, internal::MexFunctor<Result (const Type *, int nlhs, mxArray *plhs[], int nrhs, const mxArray *prhs[])>(function));
     return *this;
   }
 
   template <typename Result>
   MexMethodMap &add(const std::string& name, Result (Type::*function)(int nrhs, const mxArray *prhs[])) {
-    methods_[name] = internal::MexFunctor<Result (Type *, int nrhs, const mxArray *prhs[])>(function);
+    set(name, internal::MexFunctor<Result (Type *, int nrhs, const mxArray *prhs[])>(function));
     return *this;
   }
 
   template <typename Result>
   MexMethodMap &add(const std::string& name, Result (Type::*function)(int nrhs, const mxArray *prhs[]) const) {
-    methods_[name] = internal::MexFunctor<Result (const Type *, int nrhs, const mxArray *prhs[])>(function);
+    set(name, internal::MexFunctor<Result (const Type *, int nrhs, const mxArray *prhs[])>(function));
     return *this;
   }
 
   template <typename Result>
   MexMethodMap &add(const std::string& name, Result (Type::*function)()) {
-    methods_[name] = internal::MexFunctor<Result (Type *)>(function);
+    set(name, internal::MexFunctor<Result (Type *)>(function));
     return *this;
   }
 
   template <typename Result>
   MexMethodMap &add(const std::string& name, Result (Type::*function)() const) {
-    methods_[name] = internal::MexFunctor<Result (const Type *)>(function);
+    set(name, internal::MexFunctor<Result (const Type *)>(function));
     return *this;
   }
 
@@ -304,12 +354,28 @@ public:
 //  }
 
   bool has(const std::string& name) const {
-    return methods_.count(name);
+    return ids_.count(name);
+  }
+
+  mxArray *ids() const {
+    mxArray *result = mxCreateStructMatrix(1, 1, 0, 0);
+    for(typename std::map<std::string,std::size_t>::const_iterator it = ids_.begin(); it != ids_.end(); ++it) {
+      mxSetFieldByNumber(result, 0, mxAddField(result, it->first.c_str()), mxCreateDoubleScalar(it->second));
+    }
+    return result;
+  }
+
+  bool call(Type *object, std::size_t id, int &nlhs, mxArray **&plhs, int &nrhs, const mxArray **&prhs) const {
+    if (id >= methods_.size())
+      throw Exception(std::string() + "invalid method id for objects of class " + Object<Type>::getClassName());
+    methods_[id](object, nlhs, plhs, nrhs, prhs);
+    return true;
   }
 
   bool call(Type *object, const std::string& name, int &nlhs, mxArray **&plhs, int &nrhs, const mxArray **&prhs) const {
-    if (methods_.count(name)) {
-      methods_.at(name)(object, nlhs, plhs, nrhs, prhs);
+    typename std::map<std::string,std::size_t>::const_iterator found = ids_.find(name);
+    if (found != ids_.end()) {
+      methods_[found->second](object, nlhs, plhs, nrhs, prhs);
       return true;
     }
 
@@ -332,8 +398,26 @@ Type *mexClassHelper(int &nlhs, mxArray **&plhs, int &nrhs, const mxArray **&prh
 
   Type *object = getObject<Type>(*prhs++); nrhs--;
   method.clear();
+
+  // methods called by their id
+  if (nrhs && mxIsDouble(*prhs) && mxGetNumberOfElements(*prhs) == 1) {
+    std::size_t id = 0;
+    if (!unsignedValue(mxGetScalar(*prhs++), id)) throw ArgumentException(Object<Type>::getClassName(), "method id must be a non-negative integer");
+    nrhs--;
+    if (!object) throw Exception("Instance not found");
+    methods.call(object, id, nlhs, plhs, nrhs, prhs);
+    return object;
+  }
+
   if (nrhs) { method = Options::getString(*prhs++); nrhs--; }
 
+  // method ids are queried once by the Matlab class
+  if (method == "methodIds") {
+    plhs[0] = methods.ids();
+    method.clear();
+    return object;
+  }
+
   // construction
   if (method == "create") {
     delete object;
@@ -0,0 +1,68 @@
+//=================================================================================================
+// Copyright (c) 2013, Johannes Meyer, TU Darmstadt
+// All rights reserved.
+
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//     * Redistributions of source code must retain the above copyright
+//       notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above copyright
+//       notice, this list of conditions and the following disclaimer in the
+//       documentation and/or other materials provided with the distribution.
+//     * Neither the name of the Flight Systems and Automatic Control group,
+//       TU Darmstadt, nor the names of its contributors may be used to
+//       endorse or promote products derived from this software without
+//       specific prior written permission.
+
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+// ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+// WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER BE LIABLE FOR ANY
+// DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+// (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+// LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+// ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+// SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+//=================================================================================================
+
+
+#ifndef ROSMATLAB_PAYLOAD_H
+#define ROSMATLAB_PAYLOAD_H
+
+#include <rosmatlab/conversion.h>
+#include <ros/serialized_message.h>
+
+namespace rosmatlab {
+
+class PayloadConversion;
+typedef boost::shared_ptr<PayloadConversion> PayloadConversionPtr;
+
+/*
+  Conversion for message types with a large numeric payload field (sensor_msgs/Image,
+  sensor_msgs/PointCloud2 and std_msgs/*MultiArray). The payload is serialized straight from
+  the memory of the Matlab array if its class matches the element type of the field. All other
+  fields are converted as usual. The sensor_msgs types are only supported if rosmatlab was built
+  with sensor_msgs available.
+*/
+class PayloadConversion : public Conversion {
+public:
+  static PayloadConversionPtr create(const MessagePtr &message);
+  virtual ~PayloadConversion();
+
+  bool accepts(ConstArray source, std::size_t index = 0) const;
+  virtual ros::SerializedMessage serialize(ConstArray source, std::size_t index = 0) = 0;
+
+  virtual void convertFromMatlab(const FieldPtr& field, ConstArray source);
+
+protected:
+  PayloadConversion(const MessagePtr &message, mxClassID class_id);
+  ConstArray payload(ConstArray source, std::size_t index) const;
+
+  static const char *payload_field_;
+  mxClassID class_id_;
+};
+
+} // namespace rosmatlab
+
+#endif // ROSMATLAB_PAYLOAD_H
@@ -41,6 +41,8 @@ using cpp_introspection::VoidPtr;
 using cpp_introspection::VoidConstPtr;
 using cpp_introspection::MessagePtr;
 
+class PayloadConversion;
+
 class Publisher : public ros::Publisher, public Object<Publisher>
 {
 public:
@@ -65,6 +67,7 @@ private:
   ros::AdvertiseOptions options_;
 
   cpp_introspection::MessagePtr introspection_;
+  boost::shared_ptr<PayloadConversion> payload_;
 };
 
 } // namespace rosmatlab
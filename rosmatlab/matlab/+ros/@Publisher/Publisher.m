@@ -1,7 +1,11 @@
 classdef Publisher < handle
 
     properties (SetAccess = private, Hidden, Transient)
-        handle = 0
+        handle = uint64(0)
+    end
+
+    properties (Constant, Hidden)
+        Methods = ros.Publisher.methodIds()
     end
 
     properties (SetAccess = private)
@@ -21,34 +25,41 @@ classdef Publisher < handle
 
     methods
         function obj = Publisher(varargin)
-            obj.handle = internal(obj, 'create', varargin{:});
+            obj.handle = internal(obj.handle, 'create', varargin{:});
 
-            obj.Topic    = internal(obj, 'getTopic');
-            obj.DataType = internal(obj, 'getDataType');
-            obj.MD5Sum   = internal(obj, 'getMD5Sum');
-            obj.Latched  = internal(obj, 'isLatched');
+            obj.Topic    = internal(obj.handle, obj.Methods.getTopic);
+            obj.DataType = internal(obj.handle, obj.Methods.getDataType);
+            obj.MD5Sum   = internal(obj.handle, obj.Methods.getMD5Sum);
+            obj.Latched  = internal(obj.handle, obj.Methods.isLatched);
         end
 
         function delete(obj)
-            internal(obj, 'delete');
-            obj.handle = 0;
+            internal(obj.handle, 'delete');
+            obj.handle = uint64(0);
         end
 
         function result = advertise(obj, topic, datatype, varargin)
-            result = internal(obj, 'advertise', topic, datatype, varargin{:});
+            result = internal(obj.handle, obj.Methods.advertise, topic, datatype, varargin{:});
 
-            obj.Topic    = internal(obj, 'getTopic');
-            obj.DataType = internal(obj, 'getDataType');
-            obj.MD5Sum   = internal(obj, 'getMD5Sum');
-            obj.Latched  = internal(obj, 'isLatched');
+            obj.Topic    = internal(obj.handle, obj.Methods.getTopic);
+            obj.DataType = internal(obj.handle, obj.Methods.getDataType);
+            obj.MD5Sum   = internal(obj.handle, obj.Methods.getMD5Sum);
+            obj.Latched  = internal(obj.handle, obj.Methods.isLatched);
         end
 
         function publish(obj, varargin)
-            internal(obj, 'publish', varargin{:});
+            internal(obj.handle, obj.Methods.publish, varargin{:});
         end
 
         function result = get.NumSubscribers(obj)
-            result = internal(obj, 'getNumSubscribers');
+            result = internal(obj.handle, obj.Methods.getNumSubscribers);
+        end
+    end
+
+    methods (Static, Hidden)
+        function ids = methodIds()
+            % ids of the methods of the MEX function, used instead of their names
+            ids = internal(0, 'methodIds');
         end
     end
 end
@@ -1,10 +1,14 @@
 classdef Subscriber < handle
 
     properties (SetAccess = private, Hidden, Transient)
-        handle = 0
+        handle = uint64(0)
         poll_timer = []
     end
 
+    properties (Constant, Hidden)
+        Methods = ros.Subscriber.methodIds()
+    end
+
     properties (SetAccess = private)
         Topic = ''
         DataType = ''
@@ -26,19 +30,19 @@ classdef Subscriber < handle
 
     methods
         function obj = Subscriber(varargin)
-            obj.handle = internal(obj, 'create', varargin{:});
+            obj.handle = internal(obj.handle, 'create', varargin{:});
             obj.poll_timer = timer('ExecutionMode', 'fixedDelay', 'ObjectVisibility', 'off', 'TimerFcn', @(~,~) obj.poll(0));
 
-            obj.Topic    = internal(obj, 'getTopic');
-            obj.DataType = internal(obj, 'getDataType');
-            obj.MD5Sum   = internal(obj, 'getMD5Sum');
+            obj.Topic    = internal(obj.handle, obj.Methods.getTopic);
+            obj.DataType = internal(obj.handle, obj.Methods.getDataType);
+            obj.MD5Sum   = internal(obj.handle, obj.Methods.getMD5Sum);
         end
 
         function delete(obj)
             obj.stop();
             delete(obj.poll_timer);
-            internal(obj, 'delete');
-            obj.handle = 0;
+            internal(obj.handle, 'delete');
+            obj.handle = uint64(0);
         end
 
         function start(obj)
@@ -51,28 +55,28 @@ classdef Subscriber < handle
         end
 
         function result = subscribe(obj, topic, datatype, varargin)
-            result = internal(obj, 'subscribe', topic, datatype, varargin{:});
-            obj.Topic    = internal(obj, 'getTopic');
-            obj.DataType = internal(obj, 'getDataType');
-            obj.MD5Sum   = internal(obj, 'getMD5Sum');
+            result = internal(obj.handle, obj.Methods.subscribe, topic, datatype, varargin{:});
+            obj.Topic    = internal(obj.handle, obj.Methods.getTopic);
+            obj.DataType = internal(obj.handle, obj.Methods.getDataType);
+            obj.MD5Sum   = internal(obj.handle, obj.Methods.getMD5Sum);
         end
 
         function [message, varargout] = poll(obj, varargin)
             nargoutchk(0, 3);
-            [message, varargout{1:nargout-1}] = internal(obj, 'poll', varargin{:});
+            [message, varargout{1:nargout-1}] = internal(obj.handle, obj.Methods.poll, varargin{:});
             if (~isempty(message)); notify(obj, 'Callback', ros.MessageEvent(message, obj.Topic, obj.DataType, obj.MD5Sum)); end
         end
 
         function result = getConnectionHeader(obj)
-            result = internal(obj, 'getConnectionHeader');
+            result = internal(obj.handle, obj.Methods.getConnectionHeader);
         end
 
         function result = getReceiptTime(obj)
-            result = internal(obj, 'getReceiptTime');
+            result = internal(obj.handle, obj.Methods.getReceiptTime);
         end
 
         function result = get.NumPublishers(obj)
-            result = internal(obj, 'getNumPublishers');
+            result = internal(obj.handle, obj.Methods.getNumPublishers);
         end
 
         function set.PollPeriod(obj, period)
@@ -81,4 +85,11 @@ classdef Subscriber < handle
             obj.start();
         end
     end
+
+    methods (Static, Hidden)
+        function ids = methodIds()
+            % ids of the methods of the MEX function, used instead of their names
+            ids = internal(0, 'methodIds');
+        end
+    end
 end
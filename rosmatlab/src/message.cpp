@@ -38,8 +38,43 @@
 
 #include <boost/algorithm/string.hpp>
 
+#include <cstring>
+#include <vector>
+
 namespace rosmatlab {
 
+namespace {
+  // same as repmat(value, 1, count) for structs and numeric matrices, without calling back into Matlab
+  mxArray *replicate(const mxArray *value, std::size_t count)
+  {
+    std::size_t n = mxGetN(value);
+    if (mxIsStruct(value)) {
+      int fields = mxGetNumberOfFields(value);
+      std::vector<const char *> fieldnames(fields);
+      for(int i = 0; i < fields; ++i) fieldnames[i] = mxGetFieldNameByNumber(value, i);
+      mxArray *result = mxCreateStructMatrix(mxGetM(value), n * count, fields, fieldnames.data());
+      std::size_t elements = mxGetNumberOfElements(value);
+      for(std::size_t j = 0; j < elements * count; ++j) {
+        for(int i = 0; i < fields; ++i) {
+          const mxArray *field = mxGetFieldByNumber(value, j % elements, i);
+          if (field) mxSetFieldByNumber(result, j, i, mxDuplicateArray(field));
+        }
+      }
+      return result;
+    }
+
+    if (mxIsNumeric(value) && !mxIsComplex(value) && mxGetNumberOfDimensions(value) == 2) {
+      mwSize dims[2] = { mxGetM(value), n * count };
+      mxArray *result = mxCreateNumericArray(2, dims, mxGetClassID(value), mxREAL);
+      std::size_t size = mxGetNumberOfElements(value) * mxGetElementSize(value);
+      for(std::size_t j = 0; j < count; ++j) std::memcpy(static_cast<char *>(mxGetData(result)) + j * size, mxGetData(value), size);
+      return result;
+    }
+
+    throw Exception("cannot replicate a message of class " + std::string(mxGetClassName(value)));
+  }
+}
+
 mxArray *message_constructor(const MessagePtr& message, int nlhs, mxArray *plhs[], int nrhs, const mxArray *prhs[])
 {
   mxArray *result = 0;
@@ -111,14 +146,9 @@ mxArray *message_constructor(const MessagePtr& message, int nlhs, mxArray *plhs[
 
   // copy the contents of result if count > 1
   if (count > 1) {
-    // This seems to be a bit hacky. Is there a better solution?
-    mxArray *repmatrhs[] = { result, mxCreateDoubleScalar(1), mxCreateDoubleScalar(count) };
-    mxArray *repmatlhs[] = { 0 };
-    mexCallMATLAB(1, repmatlhs, 3, repmatrhs, "repmat");
-    mxDestroyArray(repmatrhs[0]);
-    mxDestroyArray(repmatrhs[1]);
-    mxDestroyArray(repmatrhs[2]);
-    result = repmatlhs[0];
+    mxArray *copies = replicate(result, count);
+    mxDestroyArray(result);
+    result = copies;
   }
 
   return result;
@@ -0,0 +1,212 @@
+//=================================================================================================
+// Copyright (c) 2013, Johannes Meyer, TU Darmstadt
+// All rights reserved.
+
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//     * Redistributions of source code must retain the above copyright
+//       notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above copyright
+//       notice, this list of conditions and the following disclaimer in the
+//       documentation and/or other materials provided with the distribution.
+//     * Neither the name of the Flight Systems and Automatic Control group,
+//       TU Darmstadt, nor the names of its contributors may be used to
+//       endorse or promote products derived from this software without
+//       specific prior written permission.
+
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+// ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+// WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER BE LIABLE FOR ANY
+// DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+// (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+// LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+// ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+// SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+//=================================================================================================
+
+
+#include <rosmatlab/payload.h>
+#include <rosmatlab/exception.h>
+
+#include <introspection/message.h>
+
+#ifdef ROSMATLAB_HAVE_SENSOR_MSGS
+  #include <sensor_msgs/Image.h>
+  #include <sensor_msgs/PointCloud2.h>
+#endif
+#include <std_msgs/ByteMultiArray.h>
+#include <std_msgs/Float32MultiArray.h>
+#include <std_msgs/Float64MultiArray.h>
+#include <std_msgs/Int8MultiArray.h>
+#include <std_msgs/Int16MultiArray.h>
+#include <std_msgs/Int32MultiArray.h>
+#include <std_msgs/Int64MultiArray.h>
+#include <std_msgs/UInt8MultiArray.h>
+#include <std_msgs/UInt16MultiArray.h>
+#include <std_msgs/UInt32MultiArray.h>
+#include <std_msgs/UInt64MultiArray.h>
+
+#include <cstring>
+#include <limits>
+#include <typeinfo>
+
+namespace rosmatlab {
+
+namespace {
+  // Matlab class of a payload element type
+  template <typename T> struct ClassID;
+  template <> struct ClassID<int8_t>   { static mxClassID value() { return mxINT8_CLASS;   } };
+  template <> struct ClassID<uint8_t>  { static mxClassID value() { return mxUINT8_CLASS;  } };
+  template <> struct ClassID<int16_t>  { static mxClassID value() { return mxINT16_CLASS;  } };
+  template <> struct ClassID<uint16_t> { static mxClassID value() { return mxUINT16_CLASS; } };
+  template <> struct ClassID<int32_t>  { static mxClassID value() { return mxINT32_CLASS;  } };
+  template <> struct ClassID<uint32_t> { static mxClassID value() { return mxUINT32_CLASS; } };
+  template <> struct ClassID<int64_t>  { static mxClassID value() { return mxINT64_CLASS;  } };
+  template <> struct ClassID<uint64_t> { static mxClassID value() { return mxUINT64_CLASS; } };
+  template <> struct ClassID<float>    { static mxClassID value() { return mxSINGLE_CLASS; } };
+  template <> struct ClassID<double>   { static mxClassID value() { return mxDOUBLE_CLASS; } };
+
+  // Serializes the fields in front of (head) and behind (tail) the payload in wire order
+  template <typename M> struct Layout {
+    // std_msgs/*MultiArray
+    template <typename Stream> static void head(Stream& stream, const M& m) { stream.next(m.layout); }
+    template <typename Stream> static void tail(Stream& stream, const M& m) {}
+  };
+
+#ifdef ROSMATLAB_HAVE_SENSOR_MSGS
+  template <> struct Layout<sensor_msgs::Image> {
+    template <typename Stream> static void head(Stream& stream, const sensor_msgs::Image& m) {
+      stream.next(m.header);
+      stream.next(m.height);
+      stream.next(m.width);
+      stream.next(m.encoding);
+      stream.next(m.is_bigendian);
+      stream.next(m.step);
+    }
+    template <typename Stream> static void tail(Stream& stream, const sensor_msgs::Image& m) {}
+  };
+
+  template <> struct Layout<sensor_msgs::PointCloud2> {
+    template <typename Stream> static void head(Stream& stream, const sensor_msgs::PointCloud2& m) {
+      stream.next(m.header);
+      stream.next(m.height);
+      stream.next(m.width);
+      stream.next(m.fields);
+      stream.next(m.is_bigendian);
+      stream.next(m.point_step);
+      stream.next(m.row_step);
+    }
+    template <typename Stream> static void tail(Stream& stream, const sensor_msgs::PointCloud2& m) {
+      stream.next(m.is_dense);
+    }
+  };
+#endif // ROSMATLAB_HAVE_SENSOR_MSGS
+
+  template <typename M>
+  class TypedPayloadConversion : public PayloadConversion {
+  public:
+    typedef typename M::_data_type::value_type value_type;
+
+    TypedPayloadConversion(const MessagePtr &message)
+      : PayloadConversion(message, ClassID<value_type>::value()) {}
+
+    ros::SerializedMessage serialize(ConstArray source, std::size_t index)
+    {
+      // convert all fields but the payload
+      MessagePtr message = fromMatlab(source, index);
+      boost::shared_ptr<M> instance = message->getInstanceAs<M>();
+      if (!instance) throw Exception("failed to parse message of type " + std::string(message->getDataType()));
+
+      ConstArray data = payload(source, index);
+      // the serialized message including its length prefix must fit into 32 bits
+      std::size_t size = mxGetNumberOfElements(data) * sizeof(value_type);
+      std::size_t other = ros::serialization::serializationLength(*instance);
+      if (size > std::numeric_limits<uint32_t>::max() - other - 4) throw Exception("payload of " + std::string(message->getDataType()) + " exceeds the maximum message size of 4 GB");
+      uint32_t count = static_cast<uint32_t>(mxGetNumberOfElements(data));
+      uint32_t bytes = static_cast<uint32_t>(size);
+
+      // the payload vector is empty, so serializationLength() already accounts for its length prefix
+      ros::SerializedMessage m;
+      uint32_t length = static_cast<uint32_t>(other) + bytes;
+      m.num_bytes = length + 4;
+      m.buf.reset(new uint8_t[m.num_bytes]);
+
+      ros::serialization::OStream stream(m.buf.get(), static_cast<uint32_t>(m.num_bytes));
+      stream.next(length);
+      m.message_start = stream.getData();
+      Layout<M>::head(stream, *instance);
+      stream.next(count);
+      if (bytes > 0) std::memcpy(stream.advance(bytes), mxGetData(data), bytes);
+      Layout<M>::tail(stream, *instance);
+
+      return m;
+    }
+  };
+
+  template <typename M>
+  static bool createTyped(const MessagePtr &message, PayloadConversionPtr &result)
+  {
+    if (result || message->getTypeId() != typeid(M)) return false;
+    result.reset(new TypedPayloadConversion<M>(message));
+    return true;
+  }
+}
+
+const char *PayloadConversion::payload_field_ = "data";
+
+PayloadConversionPtr PayloadConversion::create(const MessagePtr &message)
+{
+  PayloadConversionPtr result;
+  if (!message) return result;
+
+#ifdef ROSMATLAB_HAVE_SENSOR_MSGS
+  createTyped<sensor_msgs::Image>(message, result);
+  createTyped<sensor_msgs::PointCloud2>(message, result);
+#endif
+  createTyped<std_msgs::ByteMultiArray>(message, result);
+  createTyped<std_msgs::Float32MultiArray>(message, result);
+  createTyped<std_msgs::Float64MultiArray>(message, result);
+  createTyped<std_msgs::Int8MultiArray>(message, result);
+  createTyped<std_msgs::Int16MultiArray>(message, result);
+  createTyped<std_msgs::Int32MultiArray>(message, result);
+  createTyped<std_msgs::Int64MultiArray>(message, result);
+  createTyped<std_msgs::UInt8MultiArray>(message, result);
+  createTyped<std_msgs::UInt16MultiArray>(message, result);
+  createTyped<std_msgs::UInt32MultiArray>(message, result);
+  createTyped<std_msgs::UInt64MultiArray>(message, result);
+
+  return result;
+}
+
+PayloadConversion::PayloadConversion(const MessagePtr &message, mxClassID class_id)
+  : Conversion(message)
+  , class_id_(class_id)
+{
+}
+
+PayloadConversion::~PayloadConversion()
+{
+}
+
+ConstArray PayloadConversion::payload(ConstArray source, std::size_t index) const
+{
+  if (!mxIsStruct(source) || index >= mxGetNumberOfElements(source)) return 0;
+  return mxGetField(source, index, payload_field_);
+}
+
+bool PayloadConversion::accepts(ConstArray source, std::size_t index) const
+{
+  ConstArray data = payload(source, index);
+  return data && mxGetClassID(data) == class_id_ && !mxIsComplex(data);
+}
+
+void PayloadConversion::convertFromMatlab(const FieldPtr &field, ConstArray source)
+{
+  // the payload is serialized directly from the source array
+  if (std::strcmp(field->getName(), payload_field_) == 0) return;
+  Conversion::convertFromMatlab(field, source);
+}
+
+} // namespace rosmatlab
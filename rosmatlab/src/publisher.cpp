@@ -30,6 +30,7 @@
 #include <rosmatlab/exception.h>
 #include <rosmatlab/options.h>
 #include <rosmatlab/conversion.h>
+#include <rosmatlab/payload.h>
 
 #include <introspection/message.h>
 
@@ -39,6 +40,11 @@ namespace rosmatlab {
 
 template <> const char *Object<Publisher>::class_name_ = "ros.Publisher";
 
+static ros::SerializedMessage serialize(const MessagePtr& message)
+{
+  return ros::serialization::serializeMessage(*message);
+}
+
 Publisher::Publisher()
   : Object<Publisher>(this)
 {
@@ -93,6 +99,7 @@ mxArray *Publisher::advertise(int nrhs, const mxArray *prhs[])
   options_.md5sum = introspection_->getMD5Sum();
   options_.message_definition = introspection_->getDefinition();
   options_.has_header = introspection_->hasHeader();
+  payload_ = PayloadConversion::create(introspection_);
 
   *this = node_handle_.advertise(options_);
   return mxCreateLogicalScalar(*this);
@@ -104,19 +111,25 @@ void Publisher::publish(int nrhs, const mxArray *prhs[])
   if (!introspection_) throw Exception("Publisher.publish", "unknown message type");
 
   MessagePtr message;
-  ros::SerializedMessage m;
-  m.type_info = &(introspection_->getTypeId());
   Conversion conversion(introspection_);
 
   std::size_t count = conversion.numberOfInstances(prhs[0]);
   for(std::size_t i = 0; i < count; ++i) {
+    // serialize large payloads directly from the Matlab array (serfunc is called synchronously, if at all)
+    if (payload_ && payload_->accepts(prhs[0], i)) {
+      ros::SerializedMessage m;
+      ros::TopicManager::instance()->publish(ros::Publisher::getTopic(), boost::bind(&PayloadConversion::serialize, payload_, prhs[0], i), m);
+      continue;
+    }
+
     message = conversion.fromMatlab(prhs[0], i);
     if (!message) throw Exception("Publisher.publish", "failed to parse message of type " + options_.datatype);
 
-//    m.message = message->getConstInstance();
-////    ROSMATLAB_PRINTF("Publishing on topic %s...", ros::Publisher::getTopic().c_str());
-//    ros::TopicManager::instance()->publish(ros::Publisher::getTopic(), boost::bind(&serialize, message), m);
-    ros::Publisher::publish(*message);
+    // pass the instance itself to subscribers in the same process, remote subscribers get the serialized message
+    ros::SerializedMessage m;
+    m.message = message->getConstInstance();
+    m.type_info = &(introspection_->getTypeId());
+    ros::TopicManager::instance()->publish(ros::Publisher::getTopic(), boost::bind(&serialize, message), m);
   }
 }
 
@@ -50,7 +50,7 @@ public:
   VoidConstPtr deserialize(const ros::SubscriptionCallbackHelperDeserializeParams&);
   void call(ros::SubscriptionCallbackHelperCallParams& params);
   const std::type_info& getTypeInfo() { return subscriber_->introspection_->getTypeId(); }
-  bool isConst() { return false; }
+  bool isConst() { return true; }
 
 private:
   Subscriber *subscriber_;
@@ -0,0 +1,39 @@
+% Per-call overhead of the MEX dispatch of rosbag.Bag and rosbag.View.
+%
+% Every call below does almost no work in C++, so the measured time is the cost of
+% resolving the object handle and the method.
+
+calls = 100000;
+filename = [tempname '.bag'];
+
+% write a small bag file
+bag = rosbag.Bag();
+bag.open(filename, rosbag.Bag.Write);
+bag.write('/benchmark', 'std_msgs/Float64', struct('data', num2cell(1:1000)), 1:1000);
+bag.close();
+
+bag.open(filename, rosbag.Bag.Read);
+view = rosbag.View(bag);
+
+fprintf('%-24s %12s\n', 'call', 'us/call');
+
+tic;
+for i = 1:calls; bag.Mode; end
+fprintf('%-24s %12.2f\n', 'Bag.Mode', toc / calls * 1e6);
+
+tic;
+for i = 1:calls; view.Size; end
+fprintf('%-24s %12.2f\n', 'View.Size', toc / calls * 1e6);
+
+tic;
+for i = 1:calls; view.eof(); end
+fprintf('%-24s %12.2f\n', 'View.eof', toc / calls * 1e6);
+
+view.start();
+tic;
+for i = 1:calls; view.Time; end
+fprintf('%-24s %12.2f\n', 'View.Time', toc / calls * 1e6);
+
+delete(view);
+delete(bag);
+delete(filename);
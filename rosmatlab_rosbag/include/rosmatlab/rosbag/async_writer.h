@@ -0,0 +1,92 @@
+//=================================================================================================
+// Copyright (c) 2013, Johannes Meyer, TU Darmstadt
+// All rights reserved.
+
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//     * Redistributions of source code must retain the above copyright
+//       notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above copyright
+//       notice, this list of conditions and the following disclaimer in the
+//       documentation and/or other materials provided with the distribution.
+//     * Neither the name of the Flight Systems and Automatic Control group,
+//       TU Darmstadt, nor the names of its contributors may be used to
+//       endorse or promote products derived from this software without
+//       specific prior written permission.
+
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+// ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+// WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER BE LIABLE FOR ANY
+// DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+// (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+// LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+// ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+// SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+//=================================================================================================
+
+
+#ifndef ROSMATLAB_ROSBAG_ASYNC_WRITER_H
+#define ROSMATLAB_ROSBAG_ASYNC_WRITER_H
+
+#include <rosbag/bag.h>
+#include <ros/serialized_message.h>
+
+#include <boost/thread/thread.hpp>
+#include <boost/thread/mutex.hpp>
+#include <boost/thread/condition_variable.hpp>
+
+#include <deque>
+
+namespace rosmatlab {
+namespace rosbag {
+
+/*
+  Writes serialized messages to a bag from a background thread, so that chunk compression and
+  file I/O do not block Matlab. The queue is bounded by max_bytes; write() blocks while it is full.
+  Errors of the background thread are rethrown by the next call to write() or flush().
+*/
+class AsyncWriter
+{
+public:
+  AsyncWriter(::rosbag::Bag& bag, std::size_t max_bytes);
+  virtual ~AsyncWriter();
+
+  void write(const std::string& topic, const ros::Time& time, const ros::SerializedMessage& message,
+             const std::string& datatype, const std::string& md5sum, const std::string& definition,
+             const boost::shared_ptr<ros::M_string>& connection_header);
+  void flush();                                          //!< Wait until all queued messages have been written
+
+private:
+  struct Job {
+    std::string topic;
+    ros::Time time;
+    ros::SerializedMessage message;
+    std::string datatype;                                //!< Copied, the caller's connection may go away before the job is written
+    std::string md5sum;
+    std::string definition;
+    boost::shared_ptr<ros::M_string> connection_header;
+  };
+
+  void run();
+  void throwOnError();
+
+  ::rosbag::Bag& bag_;
+  std::size_t max_bytes_;
+
+  std::deque<Job> queue_;
+  std::size_t bytes_;
+  bool busy_;
+  bool stop_;
+  std::string error_;
+
+  boost::mutex mutex_;
+  boost::condition_variable changed_;
+  boost::thread thread_;
+};
+
+} // namespace rosbag
+} // namespace rosmatlab
+
+#endif // ROSMATLAB_ROSBAG_ASYNC_WRITER_H
@@ -31,10 +31,15 @@
 
 #include <rosbag/bag.h>
 #include <rosmatlab/object.h>
+#include <rosmatlab/rosbag/mapped_file.h>
+
+#include <boost/shared_ptr.hpp>
 
 namespace rosmatlab {
 namespace rosbag {
 
+class AsyncWriter;
+
 class Bag : public ::rosbag::Bag, public Object<Bag> {
 public:
   Bag();
@@ -42,9 +47,13 @@ public:
   virtual ~Bag();
 
   void open(int nrhs, const mxArray *prhs[]);
+  void save(int nrhs, const mxArray *prhs[]) const;
+  mxArray *reindex(int nrhs, const mxArray *prhs[]);     //!< Recover the messages of an unindexed bag into a new bag file
   void close();
+  void flush() const;                                    //!< Wait until all messages have been written (if opened with 'async')
 
   void data(int nlhs, mxArray *plhs[], int nrhs, const mxArray *prhs[]);
+  mxArray *info() const;                                 //!< Get per-topic statistics from the index of the bag (without reading messages)
 
   mxArray *getFileName()     const;                      //!< Get the filename of the bag
   mxArray *getMode()         const;                      //!< Get the mode the bag is in
@@ -58,6 +67,15 @@ public:
   mxArray *getChunkThreshold() const;                           //!< Get the threshold for creating new chunks
 
   void write(int nrhs, const mxArray *prhs[]);
+  mxArray *copy(int nrhs, const mxArray *prhs[]);        //!< Copy the serialized messages of another bag or view into this bag
+
+  const MappedFile *mapping() const { return mapping_.get(); }  //!< Get the memory mapping of the bag file (if opened with 'mmap')
+
+private:
+  static ros::Time headerStamp(const MessageSpan& span);
+
+  MappedFilePtr mapping_;
+  boost::shared_ptr<AsyncWriter> writer_;
 };
 
 } // namespace rosbag
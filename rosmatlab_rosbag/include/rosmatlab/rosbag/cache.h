@@ -0,0 +1,69 @@
+//=================================================================================================
+// Copyright (c) 2013, Johannes Meyer, TU Darmstadt
+// All rights reserved.
+
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//     * Redistributions of source code must retain the above copyright
+//       notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above copyright
+//       notice, this list of conditions and the following disclaimer in the
+//       documentation and/or other materials provided with the distribution.
+//     * Neither the name of the Flight Systems and Automatic Control group,
+//       TU Darmstadt, nor the names of its contributors may be used to
+//       endorse or promote products derived from this software without
+//       specific prior written permission.
+
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+// ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+// WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER BE LIABLE FOR ANY
+// DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+// (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+// LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+// ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+// SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+//=================================================================================================
+
+
+#ifndef ROSMATLAB_ROSBAG_CACHE_H
+#define ROSMATLAB_ROSBAG_CACHE_H
+
+#include <matrix.h>
+#include <stdint.h>
+#include <string>
+
+namespace rosmatlab {
+namespace rosbag {
+
+/*
+  On-disk cache of converted topics in a directory next to the bag file (<bag>.rosmatlab/).
+  Each topic is stored in one file as typed columns: numeric leaves as contiguous arrays,
+  strings dictionary-encoded and structs flattened into one column per field. An entry is
+  only valid if its key (bag size, modification time, topic md5sum, ...) matches.
+*/
+class Cache
+{
+public:
+  Cache(const std::string& bag_filename);
+  virtual ~Cache();
+
+  std::string key(const std::string& topic_key) const;  //!< Prefix a topic key with the identity of the bag file
+  const std::string& directory() const { return directory_; }
+
+  mxArray *read(const std::string& topic, const std::string& key) const;        //!< Returns 0 if there is no valid entry
+  bool write(const std::string& topic, const std::string& key, const mxArray *value) const;
+
+private:
+  std::string filename(const std::string& topic) const;
+
+  std::string directory_;
+  uint64_t bag_size_;
+  int64_t bag_mtime_;
+};
+
+} // namespace rosbag
+} // namespace rosmatlab
+
+#endif // ROSMATLAB_ROSBAG_CACHE_H
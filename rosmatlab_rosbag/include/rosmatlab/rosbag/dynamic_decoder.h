@@ -0,0 +1,92 @@
+//=================================================================================================
+// Copyright (c) 2013, Johannes Meyer, TU Darmstadt
+// All rights reserved.
+
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//     * Redistributions of source code must retain the above copyright
+//       notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above copyright
+//       notice, this list of conditions and the following disclaimer in the
+//       documentation and/or other materials provided with the distribution.
+//     * Neither the name of the Flight Systems and Automatic Control group,
+//       TU Darmstadt, nor the names of its contributors may be used to
+//       endorse or promote products derived from this software without
+//       specific prior written permission.
+
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+// ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+// WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER BE LIABLE FOR ANY
+// DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+// (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+// LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+// ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+// SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+//=================================================================================================
+
+
+#ifndef ROSMATLAB_ROSBAG_DYNAMIC_DECODER_H
+#define ROSMATLAB_ROSBAG_DYNAMIC_DECODER_H
+
+#include <matrix.h>
+
+#include <boost/shared_ptr.hpp>
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+namespace rosmatlab {
+namespace rosbag {
+
+struct MessageSpan;
+class DynamicDecoder;
+typedef boost::shared_ptr<DynamicDecoder> DynamicDecoderPtr;
+
+/*
+  Converts serialized messages to Matlab structs using the message definition from the connection
+  header of a bag, for datatypes without compiled introspection. The full definition (including
+  the MSG: sections of all nested types) is parsed into one decode plan per md5sum, which walks
+  the wire format directly. The output matches the struct conversion of Conversion: numbers as
+  double row vectors, strings as char arrays or cell arrays and nested messages as struct arrays.
+*/
+class DynamicDecoder
+{
+public:
+  enum Type { BOOL, INT8, UINT8, INT16, UINT16, INT32, UINT32, INT64, UINT64, FLOAT32, FLOAT64, STRING, TIME, DURATION, MESSAGE };
+
+  struct Field {
+    std::string name;
+    Type type;
+    int length;                                          //!< -1: scalar, 0: variable length, > 0: fixed length
+    DynamicDecoderPtr message;                           //!< Decoder of nested messages
+  };
+
+  DynamicDecoder(const std::string& datatype, const std::string& md5sum);
+  virtual ~DynamicDecoder();
+
+  //! Get the (cached) decoder for a datatype, throws the first time the definition cannot be parsed and returns null afterwards
+  static DynamicDecoderPtr get(const std::string& datatype, const std::string& md5sum, const std::string& definition);
+
+  const std::string& getDataType() const { return datatype_; }
+  const std::string& getMD5Sum() const { return md5sum_; }
+  void addField(const Field& field);
+
+  //! Convert a message into element index of a struct array of the given size (like Conversion::toMatlab)
+  mxArray *toMatlab(const MessageSpan& span, mxArray *target = 0, std::size_t index = 0, std::size_t size = 0) const;
+
+private:
+  mxArray *decode(const uint8_t *&data, const uint8_t *end, mxArray *target, std::size_t index, std::size_t size) const;
+  mxArray *decodeField(const Field& field, const uint8_t *&data, const uint8_t *end) const;
+
+  std::string datatype_;
+  std::string md5sum_;
+  std::vector<Field> fields_;
+  std::vector<const char *> fieldnames_;
+};
+
+} // namespace rosbag
+} // namespace rosmatlab
+
+#endif // ROSMATLAB_ROSBAG_DYNAMIC_DECODER_H
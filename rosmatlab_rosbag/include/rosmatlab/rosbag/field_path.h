@@ -0,0 +1,76 @@
+//=================================================================================================
+// Copyright (c) 2013, Johannes Meyer, TU Darmstadt
+// All rights reserved.
+
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//     * Redistributions of source code must retain the above copyright
+//       notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above copyright
+//       notice, this list of conditions and the following disclaimer in the
+//       documentation and/or other materials provided with the distribution.
+//     * Neither the name of the Flight Systems and Automatic Control group,
+//       TU Darmstadt, nor the names of its contributors may be used to
+//       endorse or promote products derived from this software without
+//       specific prior written permission.
+
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+// ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+// WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER BE LIABLE FOR ANY
+// DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+// (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+// LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+// ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+// SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+//=================================================================================================
+
+
+#ifndef ROSMATLAB_ROSBAG_FIELD_PATH_H
+#define ROSMATLAB_ROSBAG_FIELD_PATH_H
+
+#include <introspection/forwards.h>
+
+#include <map>
+#include <string>
+#include <vector>
+
+namespace rosmatlab {
+namespace rosbag {
+
+/*
+  A path to a field of a message, e.g. pose.position.x or ranges[0]. Field names are resolved
+  once per message type and cached.
+*/
+class FieldPath
+{
+public:
+  struct Element {
+    std::string name;
+    int index;                                           //!< -1: all elements
+  };
+
+  FieldPath();
+  FieldPath(const std::string& path);
+  static FieldPath parse(const std::string& text, std::size_t& pos);  //!< Parse a path starting at pos and advance pos
+
+  std::size_t size() const { return elements_.size(); }
+  const Element& operator[](std::size_t step) const { return elements_[step]; }
+  std::string toString() const;
+
+  //! Get the field named by the step-th element of the path in message
+  cpp_introspection::FieldPtr resolve(const cpp_introspection::MessagePtr& message, std::size_t step) const;
+
+  //! Get the numeric value at the end of the path (the first element of unindexed arrays), false if an array is too short
+  bool getDouble(const cpp_introspection::MessagePtr& message, double& value) const;
+
+private:
+  std::vector<Element> elements_;
+  mutable std::map<std::pair<std::string, std::size_t>, std::size_t> positions_;
+};
+
+} // namespace rosbag
+} // namespace rosmatlab
+
+#endif // ROSMATLAB_ROSBAG_FIELD_PATH_H
@@ -0,0 +1,86 @@
+//=================================================================================================
+// Copyright (c) 2013, Johannes Meyer, TU Darmstadt
+// All rights reserved.
+
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//     * Redistributions of source code must retain the above copyright
+//       notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above copyright
+//       notice, this list of conditions and the following disclaimer in the
+//       documentation and/or other materials provided with the distribution.
+//     * Neither the name of the Flight Systems and Automatic Control group,
+//       TU Darmstadt, nor the names of its contributors may be used to
+//       endorse or promote products derived from this software without
+//       specific prior written permission.
+
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+// ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+// WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER BE LIABLE FOR ANY
+// DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+// (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+// LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+// ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+// SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+//=================================================================================================
+
+
+#ifndef ROSMATLAB_ROSBAG_MAPPED_FILE_H
+#define ROSMATLAB_ROSBAG_MAPPED_FILE_H
+
+#include <rosbag/structures.h>
+#include <rosmatlab/rosbag/message_span.h>
+
+#include <boost/shared_ptr.hpp>
+#include <map>
+
+namespace rosmatlab {
+namespace rosbag {
+
+/*
+  Read-only memory mapping of a file. For bag files (format version 2.0), messages in uncompressed
+  chunks are returned as MessageSpans pointing directly into the mapping.
+*/
+class MappedFile
+{
+public:
+  enum Access { NORMAL, SEQUENTIAL, RANDOM };
+
+  struct Chunk {
+    std::string compression;
+    uint32_t compressed_size;
+    uint32_t uncompressed_size;
+    uint64_t data_offset;                                //!< Offset of the chunk data in the file
+  };
+
+  MappedFile(const std::string& filename);
+  virtual ~MappedFile();
+
+  const uint8_t *data() const { return data_; }
+  uint64_t size() const { return size_; }
+
+  void advise(Access access) const;                      //!< Give the kernel a hint about the upcoming access pattern
+
+  const Chunk& chunk(uint64_t chunk_pos) const;          //!< Read (and cache) the header of the chunk at chunk_pos
+  bool isCompressed(uint64_t chunk_pos) const;
+  bool span(const ::rosbag::IndexEntry& entry, MessageSpan& span) const;  //!< Get the message data of an index entry (false for compressed chunks)
+
+  //! Read the record at pos and return the position of the next record
+  uint64_t readRecord(uint64_t pos, const uint8_t *&header, uint32_t &header_length, const uint8_t *&data, uint32_t &data_length) const;
+  //! Find a field in a record header (sequence of <uint32 length><name>=<value>)
+  static bool findField(const uint8_t *header, uint32_t header_length, const std::string &name, std::string &value);
+
+private:
+
+  uint8_t *data_;
+  uint64_t size_;
+  mutable std::map<uint64_t, Chunk> chunks_;
+};
+typedef boost::shared_ptr<MappedFile> MappedFilePtr;
+
+} // namespace rosbag
+} // namespace rosmatlab
+
+#endif // ROSMATLAB_ROSBAG_MAPPED_FILE_H
@@ -0,0 +1,110 @@
+//=================================================================================================
+// Copyright (c) 2013, Johannes Meyer, TU Darmstadt
+// All rights reserved.
+
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//     * Redistributions of source code must retain the above copyright
+//       notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above copyright
+//       notice, this list of conditions and the following disclaimer in the
+//       documentation and/or other materials provided with the distribution.
+//     * Neither the name of the Flight Systems and Automatic Control group,
+//       TU Darmstadt, nor the names of its contributors may be used to
+//       endorse or promote products derived from this software without
+//       specific prior written permission.
+
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+// ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+// WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER BE LIABLE FOR ANY
+// DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+// (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+// LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+// ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+// SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+//=================================================================================================
+
+
+#ifndef ROSMATLAB_ROSBAG_MERGED_READER_H
+#define ROSMATLAB_ROSBAG_MERGED_READER_H
+
+#include <rosmatlab/rosbag/parallel_reader.h>
+
+#include <boost/thread/thread.hpp>
+#include <boost/thread/mutex.hpp>
+#include <boost/thread/condition_variable.hpp>
+
+#include <deque>
+#include <set>
+
+namespace rosmatlab {
+namespace rosbag {
+
+/*
+  Reads the messages of several bag files in time order. Every bag gets its own thread, which
+  deserializes up to prefetch messages ahead of the caller. Bags whose time ranges overlap are
+  merged with a heap on time. All other bags are concatenated, and the thread of a bag is only
+  started while the bags before it are consumed. Only the topics of the added connections are read.
+*/
+class MergedReader
+{
+public:
+  typedef ParallelReader::Entry Entry;
+
+  MergedReader(std::size_t prefetch = 1024);
+  virtual ~MergedReader();
+
+  //! begin and end are the times of the first and last message selected from the bag
+  void addQuery(const std::string& filename, const ::rosbag::Query& query, const ros::Time& begin, const ros::Time& end);
+  void addConnection(const ConnectionInfo *connection);
+
+  std::size_t bags() const { return sources_.size(); }
+  bool next(Entry& entry);
+
+private:
+  struct Source {
+    std::string filename;
+    std::vector< ::rosbag::Query> queries;
+    ros::Time begin, end;
+    std::deque<Entry> queue;
+    bool started;
+    bool done;
+  };
+
+  struct Head {
+    ros::Time time;
+    std::size_t source;
+    bool operator<(const Head& other) const { return time > other.time || (time == other.time && source > other.source); }
+  };
+
+  void group();
+  void startGroup(std::size_t group);
+  bool wait(std::size_t source, ros::Time& time);
+  void work(std::size_t source);
+  bool accept(const boost::function<bool(const ConnectionInfo *)>& query, const ConnectionInfo *connection) const;
+
+  std::size_t prefetch_;
+  std::vector<Source> sources_;
+  std::map<std::string, std::size_t> filenames_;
+  std::set<std::string> topics_;
+  std::map<std::string, cpp_introspection::MessagePtr> types_;
+  std::map<std::string, DynamicDecoderPtr> decoders_;
+
+  std::vector<std::vector<std::size_t> > groups_;
+  std::size_t group_;
+  bool primed_;
+  std::vector<Head> heap_;
+
+  bool stop_;
+  std::string error_;
+  boost::mutex mutex_;
+  boost::condition_variable changed_;
+  boost::thread_group threads_;
+};
+
+} // namespace rosbag
+} // namespace rosmatlab
+
+#endif // ROSMATLAB_ROSBAG_MERGED_READER_H
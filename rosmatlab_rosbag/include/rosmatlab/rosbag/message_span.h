@@ -0,0 +1,107 @@
+//=================================================================================================
+// Copyright (c) 2013, Johannes Meyer, TU Darmstadt
+// All rights reserved.
+
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//     * Redistributions of source code must retain the above copyright
+//       notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above copyright
+//       notice, this list of conditions and the following disclaimer in the
+//       documentation and/or other materials provided with the distribution.
+//     * Neither the name of the Flight Systems and Automatic Control group,
+//       TU Darmstadt, nor the names of its contributors may be used to
+//       endorse or promote products derived from this software without
+//       specific prior written permission.
+
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+// ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+// WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER BE LIABLE FOR ANY
+// DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+// (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+// LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+// ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+// SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+//=================================================================================================
+
+
+#ifndef ROSMATLAB_ROSBAG_MESSAGE_SPAN_H
+#define ROSMATLAB_ROSBAG_MESSAGE_SPAN_H
+
+#include <ros/message_traits.h>
+#include <ros/serialization.h>
+
+#include <cstring>
+
+namespace rosmatlab {
+namespace rosbag {
+
+/*
+  A MessageSpan refers to the serialized data of a single message without copying it.
+  MessageInstance::instantiate<MessageSpan>() returns a span pointing into the bag's internal
+  read buffer, which stays valid until the next message of the same bag is read.
+  For writing, the message type of the data can be attached to the span.
+*/
+struct MessageSpan
+{
+  MessageSpan() : data(0), size(0), datatype("*"), md5sum("*"), definition("") {}
+  MessageSpan(uint8_t *data, uint32_t size) : data(data), size(size), datatype("*"), md5sum("*"), definition("") {}
+  MessageSpan(uint8_t *data, uint32_t size, const char *datatype, const char *md5sum, const char *definition)
+    : data(data), size(size), datatype(datatype), md5sum(md5sum), definition(definition) {}
+
+  uint8_t *data;
+  uint32_t size;
+
+  const char *datatype;
+  const char *md5sum;
+  const char *definition;
+};
+
+} // namespace rosbag
+} // namespace rosmatlab
+
+namespace ros {
+namespace message_traits {
+
+template <> struct MD5Sum<rosmatlab::rosbag::MessageSpan> {
+  static const char *value() { return "*"; }
+  static const char *value(const rosmatlab::rosbag::MessageSpan& span) { return span.md5sum; }
+};
+
+template <> struct DataType<rosmatlab::rosbag::MessageSpan> {
+  static const char *value() { return "*"; }
+  static const char *value(const rosmatlab::rosbag::MessageSpan& span) { return span.datatype; }
+};
+
+template <> struct Definition<rosmatlab::rosbag::MessageSpan> {
+  static const char *value() { return ""; }
+  static const char *value(const rosmatlab::rosbag::MessageSpan& span) { return span.definition; }
+};
+
+} // namespace message_traits
+
+namespace serialization {
+
+template <> struct Serializer<rosmatlab::rosbag::MessageSpan> {
+  template <typename Stream>
+  inline static void write(Stream& stream, const rosmatlab::rosbag::MessageSpan& span) {
+    if (span.size) std::memcpy(stream.advance(span.size), span.data, span.size);
+  }
+
+  template <typename Stream>
+  inline static void read(Stream& stream, rosmatlab::rosbag::MessageSpan& span) {
+    span.size = stream.getLength();
+    span.data = stream.advance(span.size);
+  }
+
+  inline static uint32_t serializedLength(const rosmatlab::rosbag::MessageSpan& span) {
+    return span.size;
+  }
+};
+
+} // namespace serialization
+} // namespace ros
+
+#endif // ROSMATLAB_ROSBAG_MESSAGE_SPAN_H
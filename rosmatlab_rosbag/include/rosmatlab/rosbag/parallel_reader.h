@@ -0,0 +1,115 @@
+//=================================================================================================
+// Copyright (c) 2013, Johannes Meyer, TU Darmstadt
+// All rights reserved.
+
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//     * Redistributions of source code must retain the above copyright
+//       notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above copyright
+//       notice, this list of conditions and the following disclaimer in the
+//       documentation and/or other materials provided with the distribution.
+//     * Neither the name of the Flight Systems and Automatic Control group,
+//       TU Darmstadt, nor the names of its contributors may be used to
+//       endorse or promote products derived from this software without
+//       specific prior written permission.
+
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+// ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+// WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER BE LIABLE FOR ANY
+// DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+// (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+// LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+// ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+// SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+//=================================================================================================
+
+
+#ifndef ROSMATLAB_ROSBAG_PARALLEL_READER_H
+#define ROSMATLAB_ROSBAG_PARALLEL_READER_H
+
+#include <rosbag/bag.h>
+#include <rosbag/query.h>
+#include <rosmatlab/rosbag/dynamic_decoder.h>
+#include <introspection/forwards.h>
+
+#include <boost/function.hpp>
+#include <boost/thread/thread.hpp>
+#include <boost/thread/mutex.hpp>
+#include <boost/thread/condition_variable.hpp>
+
+#include <set>
+
+namespace rosmatlab {
+namespace rosbag {
+
+using ::rosbag::ConnectionInfo;
+
+/*
+  Reads the messages of a set of bag queries with a pool of worker threads. The time range is
+  split into slices that start at chunk boundaries and every worker opens its own instances of the
+  bag files, so chunk decompression and deserialization run in parallel and no chunk is read twice
+  (as long as the chunks do not overlap in time). Only the topics of the added connections are read.
+  Messages without introspection are copied for the DynamicDecoder. Conversion to Matlab arrays is
+  left to the caller, as the MEX API must only be used from the Matlab thread: next() hands out the
+  slices in time order as soon as they are done, and workers do not start another slice while the
+  finished but unconsumed slices hold more than queue_bytes of serialized messages.
+*/
+class ParallelReader
+{
+public:
+  struct Entry {
+    std::string topic;
+    ros::Time time;
+    cpp_introspection::MessagePtr introspection;
+    cpp_introspection::VoidPtr instance;
+    DynamicDecoderPtr decoder;                           //!< For datatypes without introspection, decodes buffer
+    std::vector<uint8_t> buffer;
+  };
+  typedef std::vector<Entry> Entries;
+
+  //! threads is limited to the number of cores (0: one per core)
+  ParallelReader(unsigned int threads, std::size_t queue_bytes = 256 * 1024 * 1024);
+  virtual ~ParallelReader();
+
+  void addQuery(const std::string& filename, const ::rosbag::Query& query);
+  void addConnection(const ConnectionInfo *connection);
+
+  //! Starts the workers, chunks are the start times of the chunks that hold messages in [begin, end]
+  void read(const ros::Time& begin, const ros::Time& end, std::vector<ros::Time> chunks);
+  bool next(Entries& entries);                           //!< Waits for the next slice in time order, false after the last one
+
+private:
+  void run();
+  std::size_t work(const std::map<std::string, boost::shared_ptr< ::rosbag::Bag> >& bags, std::size_t slice, Entries& entries);
+  bool accept(const boost::function<bool(const ConnectionInfo *)>& query, const ConnectionInfo *connection) const;
+  void stop();
+
+  unsigned int threads_;
+  std::size_t queue_bytes_;
+  std::vector<std::pair<std::string, ::rosbag::Query> > queries_;
+  std::set<std::string> topics_;
+  std::map<std::string, cpp_introspection::MessagePtr> types_;
+  std::map<std::string, DynamicDecoderPtr> decoders_;
+
+  std::vector<std::pair<ros::Time, ros::Time> > ranges_;  //!< Time range of every slice (end inclusive)
+  std::vector<Entries> slices_;
+  std::vector<bool> done_;
+  std::vector<std::size_t> bytes_;                       //!< Serialized size of every finished slice
+  std::size_t queued_;                                   //!< Serialized size of the finished slices not returned by next() yet
+  std::size_t claimed_;                                  //!< Slices taken by the workers
+  std::size_t consumed_;                                 //!< Slices returned by next()
+  bool stop_;
+
+  boost::thread_group workers_;
+  boost::mutex mutex_;
+  boost::condition_variable changed_;
+  std::string error_;
+};
+
+} // namespace rosbag
+} // namespace rosmatlab
+
+#endif // ROSMATLAB_ROSBAG_PARALLEL_READER_H
@@ -0,0 +1,74 @@
+//=================================================================================================
+// Copyright (c) 2013, Johannes Meyer, TU Darmstadt
+// All rights reserved.
+
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//     * Redistributions of source code must retain the above copyright
+//       notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above copyright
+//       notice, this list of conditions and the following disclaimer in the
+//       documentation and/or other materials provided with the distribution.
+//     * Neither the name of the Flight Systems and Automatic Control group,
+//       TU Darmstadt, nor the names of its contributors may be used to
+//       endorse or promote products derived from this software without
+//       specific prior written permission.
+
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+// ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+// WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER BE LIABLE FOR ANY
+// DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+// (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+// LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+// ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+// SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+//=================================================================================================
+
+
+#ifndef ROSMATLAB_ROSBAG_PREDICATE_H
+#define ROSMATLAB_ROSBAG_PREDICATE_H
+
+#include <introspection/forwards.h>
+
+#include <boost/shared_ptr.hpp>
+#include <string>
+
+namespace rosmatlab {
+namespace rosbag {
+
+class Predicate;
+typedef boost::shared_ptr<Predicate> PredicatePtr;
+
+/*
+  A boolean expression over the fields of a deserialized message, e.g.
+
+    status.level >= 2 && name == 'motor'
+    twist.linear.x > 5 || !(ranges[0] < 0.1)
+
+  Comparisons have a field path on the left and a number, a quoted string or true/false on the
+  right. Paths can index arrays (ranges[0]); comparisons with unindexed arrays are true if any
+  element matches. Field names are resolved once per message type and cached.
+*/
+class Predicate
+{
+public:
+  Predicate(const std::string& expression);
+  virtual ~Predicate();
+
+  bool operator()(const cpp_introspection::MessagePtr& message) const;
+  const std::string& getExpression() const { return expression_; }
+
+  class Node;
+  typedef boost::shared_ptr<Node> NodePtr;
+
+private:
+  std::string expression_;
+  NodePtr root_;
+};
+
+} // namespace rosbag
+} // namespace rosmatlab
+
+#endif // ROSMATLAB_ROSBAG_PREDICATE_H
@@ -30,6 +30,7 @@
 #define ROSMATLAB_ROSBAG_QUERY_H
 
 #include <rosmatlab/options.h>
+#include <rosmatlab/rosbag/predicate.h>
 #include <rosbag/query.h>
 #include <introspection/forwards.h>
 
@@ -38,6 +39,32 @@ namespace rosbag {
 
 using ::rosbag::ConnectionInfo;
 
+/*
+  Per-topic selection of messages by index and time only: every step-th message, at most rate
+  messages per second and at most max_count messages in total.
+*/
+class Decimator
+{
+public:
+  Decimator(unsigned int step = 1, double rate = 0.0, std::size_t max_count = 0);
+  static Decimator fromOptions(const Options& options);  //!< Options 'step', 'rate' and 'maxCount'
+
+  bool operator()(const ros::Time& time);                //!< Returns true if the next message is kept
+  void reset();
+
+  bool active() const { return step_ > 1 || rate_ > 0.0 || max_count_ > 0; }
+  std::string toString() const;
+
+private:
+  unsigned int step_;
+  double rate_;
+  std::size_t max_count_;
+
+  std::size_t seen_;
+  std::size_t kept_;
+  ros::Time last_;
+};
+
 class Query
 {
 public:
@@ -52,6 +79,8 @@ public:
 
   ros::Time const& getStartTime() const;
   ros::Time const& getEndTime()   const;
+  Decimator const& getDecimator() const;
+  PredicatePtr const& getPredicate() const;             //!< Option 'where', null if not given
 
   static mxArray *toMatlab(const std::vector<boost::shared_ptr<Query> >&);
 
@@ -63,6 +92,8 @@ private:
 
   ros::Time start_time_;
   ros::Time end_time_;
+  Decimator decimator_;
+  PredicatePtr predicate_;
 };
 typedef boost::shared_ptr<Query> QueryPtr;
 
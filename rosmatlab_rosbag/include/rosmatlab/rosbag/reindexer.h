@@ -0,0 +1,79 @@
+//=================================================================================================
+// Copyright (c) 2013, Johannes Meyer, TU Darmstadt
+// All rights reserved.
+
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//     * Redistributions of source code must retain the above copyright
+//       notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above copyright
+//       notice, this list of conditions and the following disclaimer in the
+//       documentation and/or other materials provided with the distribution.
+//     * Neither the name of the Flight Systems and Automatic Control group,
+//       TU Darmstadt, nor the names of its contributors may be used to
+//       endorse or promote products derived from this software without
+//       specific prior written permission.
+
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+// ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+// WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER BE LIABLE FOR ANY
+// DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+// (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+// LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+// ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+// SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+//=================================================================================================
+
+
+#ifndef ROSMATLAB_ROSBAG_REINDEXER_H
+#define ROSMATLAB_ROSBAG_REINDEXER_H
+
+#include <rosmatlab/rosbag/mapped_file.h>
+
+#include <rosbag/bag.h>
+#include <ros/datatypes.h>
+
+namespace rosmatlab {
+namespace rosbag {
+
+/*
+  Recovers the messages of a bag file (format version 2.0) without a complete index, e.g. from a
+  recording that was killed. All records of the file are scanned in order, chunks are decompressed
+  and every complete message is written to a new bag with a regular index. Scanning stops at the
+  first truncated record.
+*/
+class Reindexer
+{
+public:
+  Reindexer(const std::string& filename);
+  virtual ~Reindexer();
+
+  std::size_t write(const std::string& target);          //!< Write all recovered messages to target and return their number
+
+  //! Get a reindexed copy of an unindexed bag from the cache directory next to it, which is created if missing or outdated
+  static std::string sidecar(const std::string& filename);
+
+private:
+  struct Connection {
+    std::string topic;
+    std::string datatype;
+    std::string md5sum;
+    std::string definition;
+    boost::shared_ptr<ros::M_string> header;
+  };
+
+  void record(const uint8_t *header, uint32_t header_length, const uint8_t *data, uint32_t data_length, ::rosbag::Bag& bag);
+  void chunk(const uint8_t *data, uint32_t size, ::rosbag::Bag& bag);
+
+  std::string filename_;
+  MappedFile file_;
+  std::map<uint32_t, Connection> connections_;
+  std::size_t count_;
+};
+
+} // namespace rosbag
+} // namespace rosmatlab
+
+#endif // ROSMATLAB_ROSBAG_REINDEXER_H
@@ -0,0 +1,80 @@
+//=================================================================================================
+// Copyright (c) 2013, Johannes Meyer, TU Darmstadt
+// All rights reserved.
+
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//     * Redistributions of source code must retain the above copyright
+//       notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above copyright
+//       notice, this list of conditions and the following disclaimer in the
+//       documentation and/or other materials provided with the distribution.
+//     * Neither the name of the Flight Systems and Automatic Control group,
+//       TU Darmstadt, nor the names of its contributors may be used to
+//       endorse or promote products derived from this software without
+//       specific prior written permission.
+
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+// ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+// WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER BE LIABLE FOR ANY
+// DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+// (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+// LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+// ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+// SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+//=================================================================================================
+
+
+#ifndef ROSMATLAB_ROSBAG_RESAMPLER_H
+#define ROSMATLAB_ROSBAG_RESAMPLER_H
+
+#include <cstddef>
+#include <vector>
+
+namespace rosmatlab {
+namespace rosbag {
+
+/*
+  Interpolates signals onto a common time grid while their samples are streamed in time order.
+  Every signal fills some columns of a grid.size() x columns matrix (column-major, initialized
+  with NaN), only the last sample of each signal is kept. Grid points before the first sample of
+  a signal stay NaN, after its last sample they hold the last value (zero-order hold) or stay NaN
+  (linear).
+*/
+class Resampler
+{
+public:
+  enum Method { ZERO_ORDER_HOLD, LINEAR };
+
+  Resampler(const std::vector<double>& grid, std::size_t columns, Method method, double *output);
+  virtual ~Resampler();
+
+  std::size_t addSignal(const std::vector<std::size_t>& columns);
+  void add(std::size_t signal, double time, const std::vector<double>& values);
+  void finish();
+
+  bool done() const;                                     //!< All signals have samples beyond the end of the grid
+
+private:
+  struct Signal {
+    std::vector<std::size_t> columns;
+    std::size_t cursor;                                  //!< Next grid point to be filled
+    bool valid;
+    double time;
+    std::vector<double> values;
+  };
+
+  void set(std::size_t row, std::size_t column, double value) { output_[column * grid_.size() + row] = value; }
+
+  std::vector<double> grid_;
+  Method method_;
+  double *output_;
+  std::vector<Signal> signals_;
+};
+
+} // namespace rosbag
+} // namespace rosmatlab
+
+#endif // ROSMATLAB_ROSBAG_RESAMPLER_H
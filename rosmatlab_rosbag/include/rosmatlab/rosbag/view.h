@@ -31,6 +31,7 @@
 
 #include <rosbag/view.h>
 #include <rosmatlab/object.h>
+#include <rosmatlab/rosbag/query.h>
 
 #include <introspection/forwards.h>
 
@@ -41,7 +42,9 @@ using ::rosbag::MessageInstance;
 using ::rosbag::ConnectionInfo;
 
 class Bag;
-class Query;
+struct MessageSpan;
+class Cache;
+class DynamicDecoder;
 
 class View : public ::rosbag::View, public Object<View> {
 public:
@@ -50,8 +53,24 @@ public:
   using ::rosbag::View::iterator;
   using ::rosbag::View::const_iterator;
 
+  struct DataOptions {
+    DataOptions();
+    DataOptions(const Options& options);
+    int threads;                                         //!< Number of reader threads for data(), at most one per core (0: one per core)
+    bool cache;                                          //!< Read and write converted topics from/to the on-disk cache
+    Decimator decimator;                                 //!< Decimation of all topics (overrides the decimation of the queries)
+  };
+
+  struct SaveOptions : public DataOptions {
+    SaveOptions(const Options& options);
+    std::size_t batch;                                   //!< Number of messages held in memory, shared by the topics in proportion to their size
+    std::string mode;                                    //!< matOpen mode of the MAT-file version
+  };
+
   View(int nrhs, const mxArray *prhs[]);
   View(const Bag& bag, int nrhs, const mxArray *prhs[]);
+  View(const Bag& bag, const Options& options);
+  View(View& source, const ros::Time& begin, const ros::Time& end);
   virtual ~View();
 
   using ::rosbag::View::begin;
@@ -62,6 +81,7 @@ public:
 
   void addQuery(int nrhs, const mxArray *prhs[]);
   void addQuery(const Bag& bag, int nrhs, const mxArray *prhs[]);
+  void addQuery(const Bag& bag, const Options& options);
 
   void reset();
   bool start();
@@ -69,9 +89,19 @@ public:
   bool eof();
   void increment();
 
+  bool seek(int nrhs, const mxArray *prhs[]);
+  bool seek(const ros::Time& time);
+  bool seekIndex(int nrhs, const mxArray *prhs[]);
+  bool seekIndex(std::size_t index);
+
   void get(int nlhs, mxArray *plhs[], int nrhs, const mxArray *prhs[]);
   void next(int nlhs, mxArray *plhs[], int nrhs, const mxArray *prhs[]);
+  void next(int nlhs, mxArray *plhs[], std::size_t count, const ros::Duration& duration = ros::Duration());
   void data(int nlhs, mxArray *plhs[], int nrhs, const mxArray *prhs[]);
+  void data(int nlhs, mxArray *plhs[], const DataOptions& options);
+  void resample(int nlhs, mxArray *plhs[], int nrhs, const mxArray *prhs[]);
+  void save(int nrhs, const mxArray *prhs[]);
+  void save(const std::string& filename, const SaveOptions& options);
 
   mxArray *getTime();
   mxArray *getTopic();
@@ -88,17 +118,79 @@ public:
   mxArray *getEndTime();
 
 private:
+  struct SeekRange {
+    const ::rosbag::MessageRange *range;
+    std::vector<std::multiset< ::rosbag::IndexEntry>::const_iterator> entries;
+    std::vector<uint32_t> positions;                     //!< Position of each entry in the time-ordered view
+  };
+
+  struct FieldInfo {
+    std::string topic;
+    std::string name;
+    int fieldnum;
+    std::size_t index;
+    std::size_t size;                                    //!< Number of messages the converted array is allocated for
+    std::size_t count;                                   //!< Number of messages of the topic (more than size if save() splits it)
+    std::size_t offset;                                  //!< Number of messages in the parts written by save()
+    std::size_t part;                                    //!< Number of parts written by save()
+  };
+
   iterator& operator*();
   MessageInstance* operator->();
+
+  void resetFilters();
+  bool accept();
+  void skipRejected();
+  std::size_t countDecimated(const std::string& topic);
+
+  void addWindow(View& source, const ros::Time& begin, const ros::Time& end);
+  const std::vector<SeekRange>& seekRanges();
+  bool seekTo(const std::vector<std::size_t>& starts);
   mxArray *getInternal(mxArray *target, std::size_t index = 0, std::size_t size = 0);
 
+  const cpp_introspection::MessagePtr& introspect(const std::string& md5sum);
+  cpp_introspection::MessagePtr deserialize(const MessageSpan& span);
+  boost::shared_ptr<DynamicDecoder> dynamicDecoder(const std::string& datatype, const std::string& md5sum, const std::string& definition);
+  void addFields(std::map<std::string, FieldInfo>& topics);
+  mxArray *createStruct(const std::map<std::string, FieldInfo>& topics);
+  void countMessages(std::map<std::string, FieldInfo>& topics);
+  mxArray *convert(std::map<std::string, FieldInfo>& topics, const DataOptions& options);
+  void shrink(mxArray *data, const std::map<std::string, FieldInfo>& topics);
+  class DataScope;
+  class PartWriter;
+  struct MessageSource;
+  struct EntrySource;
+  struct InstanceSource;
+  struct MappedSource;
+  void addMessage(mxArray *data, FieldInfo& field, const ros::Time& time, MessageSource& source);
+  void dataParallel(mxArray *data, std::map<std::string, FieldInfo>& topics, int threads);
+  bool dataMapped(mxArray *data, std::map<std::string, FieldInfo>& topics);
+  bool dataMerged(mxArray *data, std::map<std::string, FieldInfo>& topics);
+  void dataSequential(mxArray *data, std::map<std::string, FieldInfo>& topics);
+
+  boost::shared_ptr<Cache> openCache();
+  std::string cacheKey(const FieldInfo& field);
+
 private:
   std::vector<boost::shared_ptr<Query> > queries_;
-  std::vector<uint8_t> read_buffer_;
 
+  cpp_introspection::MessagePtr introspection_;
+  cpp_introspection::VoidPtr instance_;
   cpp_introspection::MessagePtr message_instance_;
   iterator current_;
   bool eof_;
+  bool pending_;                                         //!< current_ has not been evaluated by the filters yet
+  iterator bound_;                                       //!< First message after the ones counted by next(), filters stop there
+
+  Decimator decimation_;
+  std::map<std::string, Decimator> decimators_;
+  std::map<std::string, PredicatePtr> predicates_;
+
+  std::vector<SeekRange> seek_index_;
+  uint32_t seek_revision_;
+  boost::shared_ptr< ::rosbag::View> seek_view_;
+
+  PartWriter *writer_;                                   //!< Writes the full parts of topics split by save()
 };
 
 } // namespace rosbag
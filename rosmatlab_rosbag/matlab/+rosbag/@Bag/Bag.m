@@ -1,7 +1,7 @@
 classdef Bag < handle
 
     properties (SetAccess = private, Hidden, Transient)
-        handle = 0
+        handle = uint64(0)
     end
 
     properties (SetAccess = private, Dependent)
@@ -22,84 +22,129 @@ classdef Bag < handle
     end
 
     properties (Constant, Hidden)
+        Methods = rosbag.Bag.methodIds()
+
         Write = uint8(1)
         Read = uint8(2)
         Append = uint8(4)
 
         Uncompressed = uint8(0)
         BZ2 = uint8(1)
+        LZ4 = uint8(2)
     end
 
     methods
         function obj = Bag(varargin)
-            obj.handle = internal(obj, 'create', varargin{:});
+            obj.handle = internal(obj.handle, 'create', varargin{:});
         end
 
         function delete(obj)
-            internal(obj, 'delete');
-            obj.handle = 0;
+            internal(obj.handle, 'delete');
+            obj.handle = uint64(0);
         end
 
         function open(obj, filename, varargin)
-            internal(obj, 'open', filename, varargin{:});
+            % open(filename, mode, 'mmap', true) maps uncompressed bags into memory for Bag.data
+            % open(filename, mode, 'async', n) writes in a background thread with up to n chunks in flight
+            % open(filename, mode, 'reindex', true) reads an unindexed bag from a reindexed copy in <filename>.rosmatlab/
+            internal(obj.handle, obj.Methods.open, filename, varargin{:});
         end
 
         function close(obj)
-            internal(obj, 'close');
+            internal(obj.handle, obj.Methods.close);
+        end
+
+        function flush(obj)
+            internal(obj.handle, obj.Methods.flush);
         end
 
         function data = data(obj, varargin)
-            data = internal(obj, 'data', varargin{:});
+            data = internal(obj.handle, obj.Methods.data, varargin{:});
+        end
+
+        function save(obj, filename, varargin)
+            % save(filename, query...) exports the selected topics to a MAT-file in a single pass (see View.save)
+            internal(obj.handle, obj.Methods.save, filename, varargin{:});
+        end
+
+        function result = info(obj)
+            % per-topic message counts, time ranges, frequencies and sizes from the index of the bag
+            result = internal(obj.handle, obj.Methods.info);
         end
 
         function write(obj, topic, datatype, data, varargin)
-            internal(obj, 'write', topic, datatype, data, varargin{:})
+            % write(topic, datatype, data, stamps) writes one message per element of data,
+            % stamped with a scalar time, a vector of times or 'header' (use header.stamp)
+            internal(obj.handle, obj.Methods.write, topic, datatype, data, varargin{:})
         end
 
-        % Get the filename of the bag
+        function count = copy(obj, source, varargin)
+            % copy(source, query...) copies the messages of a bag or view into this bag without decoding them
+            % copy(..., 'offset', dt) shifts all message times by dt seconds
+            count = internal(obj.handle, obj.Methods.copy, source, varargin{:});
+        end
+
+        % Get the filename of the bag (the reindexed copy for unindexed bags)
         function result = get.FileName(obj)
-            result = internal(obj, 'getFileName');
+            result = internal(obj.handle, obj.Methods.getFileName);
         end
 
         % Get the mode the bag is in
         function result = get.Mode(obj)
-            result = internal(obj, 'getMode');
+            result = internal(obj.handle, obj.Methods.getMode);
         end
 
         % Get the major-version of the open bag file
         function result = get.MajorVersion(obj)
-            result = internal(obj, 'getMajorVersion');
+            result = internal(obj.handle, obj.Methods.getMajorVersion);
         end
 
         % Get the minor-version of the open bag file
         function result = get.MinorVersion(obj)
-            result = internal(obj, 'getMinorVersion');
+            result = internal(obj.handle, obj.Methods.getMinorVersion);
         end
 
         % Get the current size of the bag file (a lower bound)
         function result = get.Size(obj)
-            result = internal(obj, 'getSize');
+            result = internal(obj.handle, obj.Methods.getSize);
         end
 
         % Set the compression method to use for writing chunks
         function set.Compression(obj, varargin)
-            internal(obj, 'setCompression', varargin{:});
+            internal(obj.handle, obj.Methods.setCompression, varargin{:});
         end
 
         % Get the compression method to use for writing chunks
         function result = get.Compression(obj)
-            result = internal(obj, 'getCompression');
+            result = internal(obj.handle, obj.Methods.getCompression);
         end
 
         % Set the threshold for creating new chunks
         function set.ChunkThreshold(obj, varargin)
-            internal(obj, 'setChunkThreshold', varargin{:});
+            internal(obj.handle, obj.Methods.setChunkThreshold, varargin{:});
         end
 
         % Get the threshold for creating new chunks
         function result = get.ChunkThreshold(obj)
-            result = internal(obj, 'getChunkThreshold');
+            result = internal(obj.handle, obj.Methods.getChunkThreshold);
         end
 
     end
+
+    methods (Static)
+        function count = reindex(filename, target)
+            % reindex(filename) recovers the messages of an unindexed bag into a new bag with index,
+            % the original is kept as <name>.orig.bag (or given as reindex(filename, target))
+            if (nargin < 2); target = ''; end
+            bag = rosbag.Bag();
+            count = internal(bag.handle, bag.Methods.reindex, filename, target);
+        end
+    end
+
+    methods (Static, Hidden)
+        function ids = methodIds()
+            % ids of the methods of the MEX function, used instead of their names
+            ids = internal(0, 'methodIds');
+        end
+    end
 end
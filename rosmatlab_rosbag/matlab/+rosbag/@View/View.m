@@ -1,7 +1,12 @@
 classdef View < handle
 
     properties (SetAccess = private, Hidden, Transient)
-        handle = 0
+        handle = uint64(0)
+        Cancelled = false
+    end
+
+    properties (Constant, Hidden)
+        Methods = rosbag.View.methodIds()
     end
 
     properties (SetAccess = private, Dependent)
@@ -30,96 +35,160 @@ classdef View < handle
 
     methods
         function obj = View(varargin)
-            obj.handle = internal(obj, 'create', varargin{:});
+            obj.handle = internal(obj.handle, 'create', varargin{:});
         end
 
         function delete(obj)
-            internal(obj, 'delete');
-            obj.handle = 0;
+            internal(obj.handle, 'delete');
+            obj.handle = uint64(0);
         end
 
         function result = get.Size(obj)
-            result = internal(obj, 'getSize');
+            result = internal(obj.handle, obj.Methods.getSize);
         end
 
         function addQuery(obj, bag, varargin)
-            internal(obj, 'addQuery', bag, varargin{:});
+            internal(obj.handle, obj.Methods.addQuery, bag, varargin{:});
         end
 
         function reset(obj)
-            internal(obj, 'reset');
+            internal(obj.handle, obj.Methods.reset);
         end
 
         function result = start(obj)
-            result = internal(obj, 'start');
+            result = internal(obj.handle, obj.Methods.start);
         end
 
         function result = valid(obj)
-            result = internal(obj, 'valid');
+            result = internal(obj.handle, obj.Methods.valid);
         end
 
         function result = eof(obj)
-            result = internal(obj, 'eof');
+            result = internal(obj.handle, obj.Methods.eof);
+        end
+
+        function result = seek(obj, time)
+            % positions the view at the first message at or after time (like start)
+            result = internal(obj.handle, obj.Methods.seek, time);
+        end
+
+        function result = seekIndex(obj, index)
+            % positions the view at the index-th message (like start)
+            result = internal(obj.handle, obj.Methods.seekIndex, index);
+        end
+
+        function view = window(obj, t0, t1)
+            % returns a new view restricted to messages with t0 <= time <= t1
+            view = rosbag.View(obj, t0, t1);
         end
 
         function [message, topic, datatype, varargout] = next(obj, varargin)
+            % next(N) returns up to N messages grouped by topic and a struct with the Time, Topic and ConnectionId of each message
+            % next('count', N, 'duration', d) returns the messages of the next d seconds (at most N)
+            if (~isempty(varargin) && (isnumeric(varargin{1}) || ischar(varargin{1})))
+                nargoutchk(0, 2);
+                [message, topic] = internal(obj.handle, obj.Methods.next, varargin{:});
+                return;
+            end
+
             nargoutchk(0, 5);
-            [message, topic, datatype, varargout{1:nargout-3}] = internal(obj, 'next', varargin{:});
+            [message, topic, datatype, varargout{1:nargout-3}] = internal(obj.handle, obj.Methods.next, varargin{:});
             if (~isempty(message)); notify(obj, 'Callback', ros.MessageEvent(message, topic, datatype, obj.MD5Sum)); end
         end
 
+        function forEach(obj, chunk, fcn)
+            % calls fcn(data, info) for chunks of messages until the end of the view or until cancel() is called
+            % chunk is a number of messages or a cell array of options for next, e.g. {'duration', 10}
+            % info.Progress is the fraction of the time range of the view that has been processed
+            if (~iscell(chunk)); chunk = {chunk}; end
+            obj.Cancelled = false;
+            while (~obj.Cancelled)
+                [data, info] = obj.next(chunk{:});
+                if (isempty(info.Time)); break; end
+                fcn(data, info);
+            end
+        end
+
+        function cancel(obj)
+            % stops forEach after the current chunk, the view can be resumed with next or forEach
+            obj.Cancelled = true;
+        end
+
         function varargout = get(obj, varargin)
             nargoutchk(0, 5);
-            [varargout{1:nargout}] = internal(obj, 'get', varargin{:});
+            [varargout{1:nargout}] = internal(obj.handle, obj.Methods.get, varargin{:});
         end
 
         function data = data(obj, varargin)
-            data = internal(obj, 'data', varargin{:});
+            data = internal(obj.handle, obj.Methods.data, varargin{:});
+        end
+
+        function save(obj, filename, varargin)
+            % save(filename) reads the view once and writes every topic as a variable of a MAT-file, so that load(filename)
+            % returns the struct of data() if the view has at most 'batch' messages
+            % options: those of data(), 'batch', n (at most n messages are held in memory, shared by the topics in
+            % proportion to their size; a topic with more messages than its share is written in parts as variables
+            % name_1, name_2, ..., as a MAT-file variable cannot be appended to) and 'version', '7.3', '7' or '6'
+            internal(obj.handle, obj.Methods.save, filename, varargin{:});
+        end
+
+        function [values, time] = resample(obj, grid, fields, varargin)
+            % resample(grid, fields) interpolates fields like '/odom.pose.pose.position.x' at the times in grid
+            % (or at a rate if grid is a scalar) and returns one column per field
+            % options: 'method', 'linear' or 'zoh' and 'time', 'record' or 'header' (use header.stamp)
+            [values, time] = internal(obj.handle, obj.Methods.resample, grid, fields, varargin{:});
         end
 
         function result = get.Time(obj)
-            result = internal(obj, 'getTime');
+            result = internal(obj.handle, obj.Methods.getTime);
         end
 
         function result = get.Topic(obj)
-            result = internal(obj, 'getTopic');
+            result = internal(obj.handle, obj.Methods.getTopic);
         end
 
         function result = get.DataType(obj)
-            result = internal(obj, 'getDataType');
+            result = internal(obj.handle, obj.Methods.getDataType);
         end
 
         function result = get.MD5Sum(obj)
-            result = internal(obj, 'getMD5Sum');
+            result = internal(obj.handle, obj.Methods.getMD5Sum);
         end
 
         function result = get.MessageDefinition(obj)
-            result = internal(obj, 'getMessageDefinition');
+            result = internal(obj.handle, obj.Methods.getMessageDefinition);
         end
 
         function result = get.ConnectionHeader(obj)
-            result = internal(obj, 'getConnectionHeader');
+            result = internal(obj.handle, obj.Methods.getConnectionHeader);
         end
 
         function result = get.IsLatching(obj)
-            result = internal(obj, 'isLatching');
+            result = internal(obj.handle, obj.Methods.isLatching);
         end
 
         function result = get.Queries(obj)
-            result = internal(obj, 'getQueries');
+            result = internal(obj.handle, obj.Methods.getQueries);
         end
 
         function result = get.Connections(obj)
-            result = internal(obj, 'getConnections');
+            result = internal(obj.handle, obj.Methods.getConnections);
         end
 
         function result = get.BeginTime(obj)
-            result = internal(obj, 'getBeginTime');
+            result = internal(obj.handle, obj.Methods.getBeginTime);
         end
 
         function result = get.EndTime(obj)
-            result = internal(obj, 'getEndTime');
+            result = internal(obj.handle, obj.Methods.getEndTime);
         end
 
     end
+
+    methods (Static, Hidden)
+        function ids = methodIds()
+            % ids of the methods of the MEX function, used instead of their names
+            ids = internal(0, 'methodIds');
+        end
+    end
 end
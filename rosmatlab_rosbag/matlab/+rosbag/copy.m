@@ -0,0 +1,5 @@
+function count = copy(source, target, varargin)
+% count = rosbag.copy(source, target, query...) copies the serialized messages of a bag or view
+% into the target bag. Set target.Compression and target.ChunkThreshold to recompress or rechunk,
+% use 'offset', dt to shift all message times by dt seconds.
+count = target.copy(source, varargin{:});
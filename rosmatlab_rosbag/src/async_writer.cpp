@@ -0,0 +1,131 @@
+//=================================================================================================
+// Copyright (c) 2013, Johannes Meyer, TU Darmstadt
+// All rights reserved.
+
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//     * Redistributions of source code must retain the above copyright
+//       notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above copyright
+//       notice, this list of conditions and the following disclaimer in the
+//       documentation and/or other materials provided with the distribution.
+//     * Neither the name of the Flight Systems and Automatic Control group,
+//       TU Darmstadt, nor the names of its contributors may be used to
+//       endorse or promote products derived from this software without
+//       specific prior written permission.
+
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+// ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+// WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER BE LIABLE FOR ANY
+// DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+// (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+// LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+// ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+// SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+//=================================================================================================
+
+
+#include <rosmatlab/rosbag/async_writer.h>
+#include <rosmatlab/rosbag/message_span.h>
+#include <rosmatlab/exception.h>
+
+#include <boost/bind.hpp>
+
+namespace rosmatlab {
+namespace rosbag {
+
+AsyncWriter::AsyncWriter(::rosbag::Bag& bag, std::size_t max_bytes)
+  : bag_(bag)
+  , max_bytes_(max_bytes)
+  , bytes_(0)
+  , busy_(false)
+  , stop_(false)
+{
+  thread_ = boost::thread(boost::bind(&AsyncWriter::run, this));
+}
+
+AsyncWriter::~AsyncWriter()
+{
+  {
+    boost::mutex::scoped_lock lock(mutex_);
+    stop_ = true;
+  }
+  changed_.notify_all();
+  thread_.join();
+}
+
+void AsyncWriter::write(const std::string& topic, const ros::Time& time, const ros::SerializedMessage& message,
+                        const std::string& datatype, const std::string& md5sum, const std::string& definition,
+                        const boost::shared_ptr<ros::M_string>& connection_header)
+{
+  Job job;
+  job.topic = topic;
+  job.time = time;
+  job.message = message;
+  job.datatype = datatype;
+  job.md5sum = md5sum;
+  job.definition = definition;
+  job.connection_header = connection_header;
+
+  boost::mutex::scoped_lock lock(mutex_);
+  throwOnError();
+
+  // a single message larger than the queue is accepted if the queue is empty
+  while(!queue_.empty() && bytes_ + message.num_bytes > max_bytes_) {
+    changed_.wait(lock);
+    throwOnError();
+  }
+
+  queue_.push_back(job);
+  bytes_ += message.num_bytes;
+  changed_.notify_all();
+}
+
+void AsyncWriter::flush()
+{
+  boost::mutex::scoped_lock lock(mutex_);
+  while(!queue_.empty() || busy_) changed_.wait(lock);
+  throwOnError();
+}
+
+void AsyncWriter::throwOnError()
+{
+  if (error_.empty()) return;
+  std::string error;
+  error.swap(error_);
+  throw Exception("Bag.write", error);
+}
+
+void AsyncWriter::run()
+{
+  boost::mutex::scoped_lock lock(mutex_);
+  while(true) {
+    while(queue_.empty() && !stop_) changed_.wait(lock);
+    if (queue_.empty()) break;
+
+    Job job = queue_.front();
+    queue_.pop_front();
+    busy_ = true;
+    lock.unlock();
+
+    // rosbag serializes the span into its record buffer and compresses full chunks in this thread
+    try {
+      MessageSpan span(job.message.message_start, job.message.num_bytes - (job.message.message_start - job.message.buf.get()),
+                       job.datatype.c_str(), job.md5sum.c_str(), job.definition.c_str());
+      bag_.write(job.topic, job.time, span, job.connection_header);
+    } catch(std::exception& e) {
+      boost::mutex::scoped_lock error_lock(mutex_);
+      if (error_.empty()) error_ = e.what();
+    }
+
+    lock.lock();
+    busy_ = false;
+    bytes_ -= job.message.num_bytes;
+    changed_.notify_all();
+  }
+}
+
+} // namespace rosbag
+} // namespace rosmatlab
@@ -28,12 +28,25 @@
 
 #include <rosmatlab/rosbag/bag.h>
 #include <rosmatlab/conversion.h>
+#include <rosmatlab/payload.h>
 #include <rosmatlab/connection_header.h>
 #include <rosmatlab/log.h>
 
 #include <rosmatlab/rosbag/view.h>
+#include <rosmatlab/rosbag/message_span.h>
+#include <rosmatlab/rosbag/async_writer.h>
+#include <rosmatlab/rosbag/reindexer.h>
 
 #include <introspection/message.h>
+#include <ros/common.h>
+#include <rosbag/exceptions.h>
+
+#include <boost/lexical_cast.hpp>
+
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <set>
 
 namespace rosmatlab {
 namespace rosbag {
@@ -52,7 +65,11 @@ Bag::Bag(int nrhs, const mxArray *prhs[])
 }
 
 Bag::~Bag() {
-  close();
+  try {
+    close();
+  } catch(Exception& e) {
+    ROSMATLAB_WARN("%s", e.what());
+  }
 }
 
 void Bag::open(int nrhs, const mxArray *prhs[])
@@ -66,22 +83,122 @@ void Bag::open(int nrhs, const mxArray *prhs[])
     if (mode > 7) throw Exception("Bag.open", "Invalid value for mode");
   }
 
+  Options options;
+  if (nrhs > 2) options.init(nrhs - 2, prhs + 2, true);
+  bool mmap = options.getBool("mmap");
+  int async = options.getInteger("async");
+  bool reindex = options.getBool("reindex");
+  options.throwOnUnused();
+
+  flush();
+  writer_.reset();
+  mapping_.reset();
   try {
     ::rosbag::Bag::open(filename, mode);
+  } catch(::rosbag::BagUnindexedException &e) {
+    // rosbag throws after the file has been opened
+    ::rosbag::Bag::close();
+
+    // unindexed bags are read from a reindexed copy in the cache directory next to them
+    if (!reindex || mode != ::rosbag::bagmode::Read) throw Exception("Bag.open", filename + " is not indexed (open it with 'reindex', true)");
+    filename = Reindexer::sidecar(filename);
+    try {
+      ::rosbag::Bag::open(filename, mode);
+    } catch(std::runtime_error &e) {
+      throw Exception(e);
+    }
   } catch(std::runtime_error &e) {
     throw Exception(e);
   }
+
+  // memory mapping is only supported for bags in read mode and format version 2.0
+  if (mmap) {
+    if (mode != ::rosbag::bagmode::Read || ::rosbag::Bag::getMajorVersion() != 2) throw Exception("Bag.open", "memory mapping requires a bag of version 2.0 in read mode");
+    mapping_.reset(new MappedFile(filename));
+  }
+
+  // write from a background thread with up to async chunks in flight
+  if (async > 0) {
+    if (!(mode & (::rosbag::bagmode::Write | ::rosbag::bagmode::Append))) throw Exception("Bag.open", "asynchronous writing requires write or append mode");
+    writer_.reset(new AsyncWriter(*this, static_cast<std::size_t>(async) * ::rosbag::Bag::getChunkThreshold()));
+  }
+}
+
+mxArray *Bag::reindex(int nrhs, const mxArray *prhs[])
+{
+  if (nrhs < 1) throw ArgumentException("Bag.reindex", 1);
+  std::string filename = Options::getString(prhs[0]);
+  std::string target = (nrhs > 1) ? Options::getString(prhs[1]) : std::string();
+
+  if (!target.empty()) {
+    try {
+      return mxCreateDoubleScalar(Reindexer(filename).write(target));
+    } catch(std::runtime_error &e) {
+      throw Exception(e);
+    }
+  }
+
+  // like rosbag reindex, the original is kept as <name>.orig.bag if no target is given, but it is only renamed
+  // after the reindexed copy has been written to a temporary file
+  std::string::size_type extension = filename.rfind(".bag");
+  std::string original = (extension != std::string::npos && extension + 4 == filename.size() ? filename.substr(0, extension) : filename) + ".orig.bag";
+  std::string temporary = filename + ".reindex.tmp";
+  std::size_t count = 0;
+  try {
+    count = Reindexer(filename).write(temporary);
+  } catch(std::runtime_error &e) {
+    std::remove(temporary.c_str());
+    throw Exception(e);
+  }
+
+  if (std::rename(filename.c_str(), original.c_str()) < 0) {
+    std::string error = std::strerror(errno);
+    std::remove(temporary.c_str());
+    throw Exception("Bag.reindex", "could not rename " + filename + " to " + original + ": " + error);
+  }
+  if (std::rename(temporary.c_str(), filename.c_str()) < 0) {
+    std::string error = std::strerror(errno);
+    std::rename(original.c_str(), filename.c_str());
+    std::remove(temporary.c_str());
+    throw Exception("Bag.reindex", "could not rename " + temporary + " to " + filename + ": " + error);
+  }
+  return mxCreateDoubleScalar(count);
 }
 
 void Bag::close()
 {
+  mapping_.reset();
+
+  // drain the background writer first, errors are rethrown after the bag has been closed
+  boost::shared_ptr<AsyncWriter> writer;
+  writer.swap(writer_);
+  std::string error;
+  if (writer) {
+    try {
+      writer->flush();
+    } catch(Exception& e) {
+      error = e.what();
+    }
+    writer.reset();
+  }
+
   ::rosbag::Bag::close();
+  if (!error.empty()) throw Exception(error);
+}
+
+void Bag::flush() const
+{
+  if (writer_) writer_->flush();
 }
 
 void Bag::data(int nlhs, mxArray *plhs[], int nrhs, const mxArray *prhs[])
 {
-  View view(*this, nrhs, prhs);
-  view.data(nlhs, plhs, 0, 0);
+  // data options must be read before the remaining options are parsed as query
+  flush();
+  Options options(nrhs, prhs, true);
+  View::DataOptions data_options(options);
+  View view(*this, options);
+  view.data(nlhs, plhs, data_options);
 
   // if only one topic has been given as a single parameter, return data without the outer struct
   if (nrhs % 2 != 0 && mxIsStruct(plhs[0])) {
@@ -96,6 +213,139 @@ void Bag::data(int nlhs, mxArray *plhs[], int nrhs, const mxArray *prhs[])
   }
 }
 
+void Bag::save(int nrhs, const mxArray *prhs[]) const
+{
+  if (nrhs < 1) throw ArgumentException("Bag.save", 1);
+  flush();
+  std::string filename = Options::getString(prhs[0]);
+  Options options(nrhs - 1, prhs + 1, true);
+  View::SaveOptions save_options(options);
+  View view(*this, options);
+  view.save(filename, save_options);
+}
+
+namespace {
+  // gives access to the index ranges of a view on the complete bag
+  class IndexView : public ::rosbag::View {
+  public:
+    IndexView(const ::rosbag::Bag& bag) : ::rosbag::View(bag) {}
+    const std::vector< ::rosbag::MessageRange* >& ranges() { update(); return ranges_; }
+  };
+
+  struct TopicInfo {
+    TopicInfo() : count(0), start(ros::TIME_MAX), end(ros::TIME_MIN), compressed(0.0), uncompressed(0.0) {}
+    std::string datatype;
+    std::string md5sum;
+    std::set<uint32_t> connections;
+    std::size_t count;
+    ros::Time start;
+    ros::Time end;
+    double compressed;
+    double uncompressed;
+  };
+}
+
+mxArray *Bag::info() const
+{
+  flush();
+
+  // count messages per topic and per chunk on the index only
+  std::map<std::string, TopicInfo> topics;
+  std::map<uint32_t, TopicInfo *> connection_topics;
+  std::map<uint64_t, std::map<uint32_t, std::size_t> > chunks;
+  IndexView view(*this);
+  for(std::vector< ::rosbag::MessageRange* >::const_iterator range = view.ranges().begin(); range != view.ranges().end(); ++range) {
+    const ConnectionInfo *connection = (*range)->connection_info;
+    TopicInfo &topic = topics[connection->topic];
+    topic.datatype = connection->datatype;
+    topic.md5sum = connection->md5sum;
+    topic.connections.insert(connection->id);
+    connection_topics[connection->id] = &topic;
+    if ((*range)->begin == (*range)->end) continue;
+
+    topic.count += std::distance((*range)->begin, (*range)->end);
+    std::multiset< ::rosbag::IndexEntry>::const_iterator last = (*range)->end;
+    --last;
+    topic.start = std::min(topic.start, (*range)->begin->time);
+    topic.end = std::max(topic.end, last->time);
+
+    // consecutive entries mostly share their chunk, so the counter is only looked up when the chunk changes
+    std::size_t *counter = 0;
+    uint64_t chunk_pos = 0;
+    for(std::multiset< ::rosbag::IndexEntry>::const_iterator entry = (*range)->begin; entry != (*range)->end; ++entry) {
+      if (!counter || entry->chunk_pos != chunk_pos) {
+        chunk_pos = entry->chunk_pos;
+        counter = &chunks[chunk_pos][connection->id];
+      }
+      (*counter)++;
+    }
+  }
+
+  // apportion the size of every chunk to its topics by message count (chunk headers are read from the file)
+  double compressed = mxGetNaN(), uncompressed = mxGetNaN();
+  MappedFilePtr mapping = mapping_;
+  if (!mapping && ::rosbag::Bag::getMode() == ::rosbag::bagmode::Read && ::rosbag::Bag::getMajorVersion() == 2) {
+    mapping.reset(new MappedFile(::rosbag::Bag::getFileName()));
+  }
+  if (mapping) {
+    mapping->advise(MappedFile::RANDOM);
+    compressed = uncompressed = 0.0;
+    for(std::map<uint64_t, std::map<uint32_t, std::size_t> >::const_iterator chunk = chunks.begin(); chunk != chunks.end(); ++chunk) {
+      const MappedFile::Chunk &header = mapping->chunk(chunk->first);
+      compressed += header.compressed_size;
+      uncompressed += header.uncompressed_size;
+
+      std::size_t messages = 0;
+      for(std::map<uint32_t, std::size_t>::const_iterator it = chunk->second.begin(); it != chunk->second.end(); ++it) messages += it->second;
+      for(std::map<uint32_t, std::size_t>::const_iterator it = chunk->second.begin(); it != chunk->second.end(); ++it) {
+        TopicInfo &topic = *connection_topics[it->first];
+        topic.compressed += static_cast<double>(header.compressed_size) * it->second / messages;
+        topic.uncompressed += static_cast<double>(header.uncompressed_size) * it->second / messages;
+      }
+    }
+  }
+
+  // create result struct
+  static const char *topic_fieldnames[] = { "Topic", "DataType", "MD5Sum", "Connections", "Messages", "StartTime", "EndTime", "Frequency", "CompressedBytes", "UncompressedBytes" };
+  mxArray *topic_info = mxCreateStructMatrix(topics.size(), 1, sizeof(topic_fieldnames)/sizeof(*topic_fieldnames), topic_fieldnames);
+  std::size_t messages = 0;
+  ros::Time start = ros::TIME_MAX, end = ros::TIME_MIN;
+  mwIndex i = 0;
+  for(std::map<std::string, TopicInfo>::const_iterator it = topics.begin(); it != topics.end(); ++it, ++i) {
+    const TopicInfo &topic = it->second;
+    mxSetField(topic_info, i, "Topic",    mxCreateString(it->first));
+    mxSetField(topic_info, i, "DataType", mxCreateString(topic.datatype));
+    mxSetField(topic_info, i, "MD5Sum",   mxCreateString(topic.md5sum));
+    mxSetField(topic_info, i, "Connections", mxCreateDoubleScalar(topic.connections.size()));
+    mxSetField(topic_info, i, "Messages", mxCreateDoubleScalar(topic.count));
+    mxSetField(topic_info, i, "CompressedBytes",   mxCreateDoubleScalar(mapping ? topic.compressed : mxGetNaN()));
+    mxSetField(topic_info, i, "UncompressedBytes", mxCreateDoubleScalar(mapping ? topic.uncompressed : mxGetNaN()));
+    if (topic.count == 0) continue;
+
+    double duration = (topic.end - topic.start).toSec();
+    mxSetField(topic_info, i, "StartTime", mxCreateTime(topic.start));
+    mxSetField(topic_info, i, "EndTime",   mxCreateTime(topic.end));
+    mxSetField(topic_info, i, "Frequency", mxCreateDoubleScalar(duration > 0.0 ? (topic.count - 1) / duration : mxGetNaN()));
+
+    messages += topic.count;
+    start = std::min(start, topic.start);
+    end = std::max(end, topic.end);
+  }
+
+  static const char *fieldnames[] = { "FileName", "StartTime", "EndTime", "Duration", "Messages", "Chunks", "CompressedBytes", "UncompressedBytes", "Topics" };
+  mxArray *result = mxCreateStructMatrix(1, 1, sizeof(fieldnames)/sizeof(*fieldnames), fieldnames);
+  mxSetField(result, 0, "FileName", mxCreateString(::rosbag::Bag::getFileName()));
+  mxSetField(result, 0, "StartTime", mxCreateTime(start));
+  mxSetField(result, 0, "EndTime", mxCreateTime(end));
+  mxSetField(result, 0, "Duration", mxCreateDoubleScalar(messages > 0 ? (end - start).toSec() : 0.0));
+  mxSetField(result, 0, "Messages", mxCreateDoubleScalar(messages));
+  mxSetField(result, 0, "Chunks", mxCreateDoubleScalar(chunks.size()));
+  mxSetField(result, 0, "CompressedBytes", mxCreateDoubleScalar(compressed));
+  mxSetField(result, 0, "UncompressedBytes", mxCreateDoubleScalar(uncompressed));
+  mxSetField(result, 0, "Topics", topic_info);
+  return result;
+}
+
 mxArray *Bag::getFileName() const
 {
   return mxCreateString(::rosbag::Bag::getFileName().c_str());
@@ -124,6 +374,7 @@ mxArray *Bag::getMinorVersion() const
 
 mxArray *Bag::getSize() const
 {
+  flush();
   mxArray *result = mxCreateNumericMatrix(1, 1, mxUINT64_CLASS, mxREAL);
   *static_cast<uint64_T *>(mxGetData(result)) = static_cast<uint64_T>(::rosbag::Bag::getSize());
   return result;
@@ -133,8 +384,13 @@ void Bag::setCompression(int nrhs, const mxArray *prhs[])
 {
   if (nrhs < 1) throw ArgumentException("Bag.setCompression", 1);
   int value = Options::getIntegerScalar(prhs[0]);
+#if ROS_VERSION_MINIMUM(1,11,0)
+  if (value < 0 || value > ::rosbag::compression::LZ4) throw Exception("Bag.setCompression", "Invalid value for property Compression");
+#else
   if (value < 0 || value > ::rosbag::compression::BZ2) throw Exception("Bag.setCompression", "Invalid value for property Compression");
+#endif
   ::rosbag::compression::CompressionType compression = static_cast< ::rosbag::compression::CompressionType >(Options::getIntegerScalar(prhs[0]));
+  flush();
   ::rosbag::Bag::setCompression(compression);
 }
 
@@ -149,6 +405,7 @@ void Bag::setChunkThreshold(int nrhs, const mxArray *prhs[])
 {
   if (nrhs < 1) throw ArgumentException("Bag.setChunkThreshold", 1);
   uint32_t chunkThreshold = static_cast<uint32_t>(Options::getIntegerScalar(prhs[0]));
+  flush();
   ::rosbag::Bag::setChunkThreshold(chunkThreshold);
 }
 
@@ -169,6 +426,8 @@ void Bag::write(int nrhs, const mxArray *prhs[])
   const mxArray *data = prhs[2];
   ConnectionHeader connection_header;
   ros::Time timestamp;
+  const mxArray *timestamps = 0;
+  bool header_stamps = false;
   for(int i = 3; i < nrhs; ++i) {
     if (mxIsStruct(prhs[i])) {
       if (!connection_header.fromMatlab(prhs[i])) throw Exception("Bag.write", "failed to parse connection header");
@@ -179,6 +438,24 @@ void Bag::write(int nrhs, const mxArray *prhs[])
       timestamp = ros::Time(Options::getDoubleScalar(prhs[i]));
       continue;
     }
+
+    // one timestamp per instance
+    if (mxIsDouble(prhs[i]) && !mxIsEmpty(prhs[i])) {
+      timestamps = prhs[i];
+      continue;
+    }
+
+    // take timestamps from header.stamp
+    if (Options::isString(prhs[i]) && Options::getString(prhs[i]) == "header") {
+      header_stamps = true;
+      continue;
+    }
+
+    // an empty matrix stands for the current time
+    if (mxIsDouble(prhs[i])) continue;
+
+    if (Options::isString(prhs[i])) throw ArgumentException("Bag.write", "unknown argument '" + Options::getString(prhs[i]) + "'");
+    throw ArgumentException("Bag.write", std::string("unexpected argument of class ") + mxGetClassName(prhs[i]));
   }
 
   // set timestamp to current time if no timestamp was given
@@ -187,17 +464,111 @@ void Bag::write(int nrhs, const mxArray *prhs[])
   // introspect message
   MessagePtr introspection = cpp_introspection::messageByDataType(datatype);
   if (!introspection) throw Exception("Bag.write", "unknown datatype '" + datatype + "'");
+  if (header_stamps && !introspection->hasHeader()) throw Exception("Bag.write", "messages of type " + datatype + " have no header");
+
+  std::size_t count = Conversion(introspection).numberOfInstances(data);
+  if (timestamps && mxGetNumberOfElements(timestamps) != count) throw Exception("Bag.write", "the number of timestamps does not match the number of messages");
+
+  // one conversion and one message instance are reused for all instances
   Conversion conversion(introspection);
+  MessagePtr message = introspection->introspect(introspection->createInstance());
+  PayloadConversionPtr payload = PayloadConversion::create(introspection);
 
   // ... and finally write data to the bag
-  std::size_t count = conversion.numberOfInstances(data);
   for(std::size_t i = 0; i < count; ++i) {
-    MessagePtr message = Conversion(introspection).fromMatlab(data, i);
-    if (!message) throw Exception("Bag.write", "failed to parse message of type " + datatype);
+    ros::Time stamp = timestamps ? ros::Time(mxGetPr(timestamps)[i]) : timestamp;
+
+    // serialize in the Matlab thread and leave writing and compression to the background writer
+    if (writer_) {
+      ros::SerializedMessage serialized;
+      if (payload && payload->accepts(data, i)) {
+        serialized = payload->serialize(data, i);
+      } else {
+        conversion.fromMatlab(message, data, i);
+        serialized = ros::serialization::serializeMessage(*message);
+      }
+      if (header_stamps) stamp = headerStamp(MessageSpan(serialized.message_start, serialized.num_bytes - (serialized.message_start - serialized.buf.get())));
+      writer_->write(topic, stamp, serialized, introspection->getDataType(), introspection->getMD5Sum(), introspection->getDefinition(), connection_header);
+      continue;
+    }
+
+    // large payloads are serialized from the Matlab array and copied into the bag as they are
+    if (payload && payload->accepts(data, i)) {
+      ros::SerializedMessage serialized = payload->serialize(data, i);
+      MessageSpan span(serialized.message_start, serialized.num_bytes - (serialized.message_start - serialized.buf.get()),
+                       introspection->getDataType(), introspection->getMD5Sum(), introspection->getDefinition());
+      if (header_stamps) stamp = headerStamp(span);
+      ::rosbag::Bag::write(topic, stamp, span, connection_header);
+      continue;
+    }
 
-    ::rosbag::Bag::write(topic, timestamp, *message, connection_header);
+    conversion.fromMatlab(message, data, i);
+    if (header_stamps) stamp = message->getHeader(message->getConstInstance())->stamp;
+    ::rosbag::Bag::write(topic, stamp, *message, connection_header);
   }
 }
 
+mxArray *Bag::copy(int nrhs, const mxArray *prhs[])
+{
+  if (nrhs < 1) throw ArgumentException("Bag.copy", 1);
+
+  Options options(nrhs - 1, prhs + 1, true);
+  ros::Duration offset(options.getDouble("offset"));
+
+  // the source is a view or a bag, which is filtered by the remaining options like a query
+  boost::shared_ptr<View> view;
+  if (View *source = getObject<View>(prhs[0])) {
+    options.throwOnUnused();
+    // iterate over a window of the whole view, so that the cursor of the caller's view is left alone
+    view.reset(new View(*source, ros::TIME_MIN, ros::TIME_MAX));
+  } else {
+    const Bag *source = getObject<Bag>(prhs[0]);
+    if (!source) throw Exception("Bag.copy", "first argument is not a valid bag or view handle");
+    if (source == this) throw Exception("Bag.copy", "cannot copy a bag into itself");
+    view.reset(new View(*source, options));
+  }
+
+  // check the offset before anything is written
+  if (offset < ros::Duration() && view->size() > 0 && view->::rosbag::View::getBeginTime().toSec() < -offset.toSec()) {
+    throw Exception("Bag.copy", "offset moves messages before time zero");
+  }
+
+  // messages are written as they are stored in the source bag, without deserializing them
+  std::size_t count = 0;
+  try {
+    for(view->start(); view->valid(); view->increment()) {
+      const MessageInstance &message = *view->operator->();
+      ros::Time time = message.getTime() + offset;
+
+      if (writer_) {
+        ros::SerializedMessage serialized = ros::serialization::serializeMessage(message);
+        writer_->write(message.getTopic(), time, serialized, message.getDataType(), message.getMD5Sum(),
+                       message.getMessageDefinition(), message.getConnectionHeader());
+      } else {
+        ::rosbag::Bag::write(message.getTopic(), time, message, message.getConnectionHeader());
+      }
+      count++;
+    }
+  } catch(std::runtime_error &e) {
+    // the messages copied so far stay in the bag
+    try { flush(); } catch(std::runtime_error &) {}
+    throw Exception("Bag.copy", "copy failed after " + boost::lexical_cast<std::string>(count) + " messages: " + e.what());
+  }
+
+  // all messages are in the bag when copy() returns
+  flush();
+  return mxCreateDoubleScalar(count);
 }
+
+ros::Time Bag::headerStamp(const MessageSpan& span)
+{
+  // the header is the first field (uint32 seq, time stamp, string frame_id)
+  if (span.size < 12) throw Exception("Bag.write", "serialized message is too short for a header");
+  uint32_t sec, nsec;
+  std::memcpy(&sec,  span.data + 4, sizeof(sec));
+  std::memcpy(&nsec, span.data + 8, sizeof(nsec));
+  return ros::Time(sec, nsec);
 }
+
+} // namespace rosbag
+} // namespace rosmatlab
@@ -0,0 +1,415 @@
+//=================================================================================================
+// Copyright (c) 2013, Johannes Meyer, TU Darmstadt
+// All rights reserved.
+
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//     * Redistributions of source code must retain the above copyright
+//       notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above copyright
+//       notice, this list of conditions and the following disclaimer in the
+//       documentation and/or other materials provided with the distribution.
+//     * Neither the name of the Flight Systems and Automatic Control group,
+//       TU Darmstadt, nor the names of its contributors may be used to
+//       endorse or promote products derived from this software without
+//       specific prior written permission.
+
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+// ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+// WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER BE LIABLE FOR ANY
+// DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+// (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+// LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+// ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+// SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+//=================================================================================================
+
+
+#include <rosmatlab/rosbag/cache.h>
+#include <rosmatlab/rosbag/mapped_file.h>
+#include <rosmatlab/exception.h>
+
+#include <sys/stat.h>
+#include <sys/types.h>
+
+#include <boost/lexical_cast.hpp>
+
+#include <cctype>
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <map>
+#include <vector>
+
+namespace rosmatlab {
+namespace rosbag {
+
+namespace {
+  const char MAGIC[8] = { 'R', 'M', 'C', 'A', 'C', 'H', 'E', '1' };
+
+  // column types
+  enum { COLUMN_DENSE = 1, COLUMN_STRING, COLUMN_STRUCT, COLUMN_CELL, COLUMN_RAGGED };
+
+  typedef std::vector<const mxArray *> Values;
+  typedef std::vector<mxArray *> Arrays;
+
+  class Writer {
+  public:
+    Writer(std::ostream& stream) : stream_(stream), pos_(0) {}
+
+    void write(const void *data, std::size_t size) { stream_.write(static_cast<const char *>(data), size); pos_ += size; }
+    void write(uint32_t value) { write(&value, sizeof(value)); }
+    void write(const std::string& value) { write(static_cast<uint32_t>(value.size())); write(value.data(), value.size()); }
+    void align(std::size_t alignment) { static const char zeros[8] = { 0 }; if (pos_ % alignment) write(zeros, alignment - pos_ % alignment); }
+
+  private:
+    std::ostream& stream_;
+    uint64_t pos_;
+  };
+
+  class Reader {
+  public:
+    Reader(const uint8_t *data, uint64_t size) : data_(data), size_(size), pos_(0) {}
+
+    const uint8_t *read(std::size_t size) {
+      if (size > size_ - pos_) throw Exception("Cache", "unexpected end of file");
+      const uint8_t *result = data_ + pos_;
+      pos_ += size;
+      return result;
+    }
+    uint32_t readUInt32() { uint32_t value; std::memcpy(&value, read(sizeof(value)), sizeof(value)); return value; }
+    std::string readString() { uint32_t size = readUInt32(); return std::string(reinterpret_cast<const char *>(read(size)), size); }
+    void align(std::size_t alignment) { if (pos_ % alignment) read(alignment - pos_ % alignment); }
+
+  private:
+    const uint8_t *data_;
+    uint64_t size_;
+    uint64_t pos_;
+  };
+
+  bool isPlain(const mxArray *value) {
+    if (!value) return false;
+    if (!mxIsNumeric(value) && !mxIsLogical(value) && !mxIsChar(value)) return false;
+    return !mxIsComplex(value) && !mxIsSparse(value) && mxGetNumberOfDimensions(value) == 2;
+  }
+
+  bool sameShape(const mxArray *a, const mxArray *b) {
+    return mxGetNumberOfDimensions(a) == 2 && mxGetNumberOfDimensions(b) == 2 && mxGetM(a) == mxGetM(b) && mxGetN(a) == mxGetN(b);
+  }
+
+  bool sameFields(const mxArray *a, const mxArray *b) {
+    int n = mxGetNumberOfFields(a);
+    if (n != mxGetNumberOfFields(b)) return false;
+    for(int i = 0; i < n; ++i) {
+      if (std::strcmp(mxGetFieldNameByNumber(a, i), mxGetFieldNameByNumber(b, i)) != 0) return false;
+    }
+    return true;
+  }
+
+  mxArray *createArray(mxClassID class_id, std::size_t rows, std::size_t cols) {
+    mwSize dims[2] = { rows, cols };
+    if (class_id == mxCHAR_CLASS)    return mxCreateCharArray(2, dims);
+    if (class_id == mxLOGICAL_CLASS) return mxCreateLogicalArray(2, dims);
+    return mxCreateNumericArray(2, dims, class_id, mxREAL);
+  }
+
+  std::size_t elementSize(mxClassID class_id) {
+    switch(class_id) {
+      case mxLOGICAL_CLASS: case mxINT8_CLASS: case mxUINT8_CLASS:   return 1;
+      case mxCHAR_CLASS:    case mxINT16_CLASS: case mxUINT16_CLASS: return 2;
+      case mxSINGLE_CLASS:  case mxINT32_CLASS: case mxUINT32_CLASS: return 4;
+      case mxDOUBLE_CLASS:  case mxINT64_CLASS: case mxUINT64_CLASS: return 8;
+      default: throw Exception("Cache", "invalid class id");
+    }
+  }
+
+  // write the values of one column, returns false if they cannot be represented
+  bool encode(Writer& writer, const Values& values)
+  {
+    const mxArray *first = values.empty() ? 0 : values.front();
+    bool dense = isPlain(first), string = dense && mxIsChar(first), structure = first && mxIsStruct(first), cell = first && mxIsCell(first), ragged = true;
+    for(Values::const_iterator it = values.begin(); it != values.end(); ++it) {
+      const mxArray *value = *it;
+      if (value && !isPlain(value)) ragged = false;
+      if (!value || !isPlain(value) || mxGetClassID(value) != mxGetClassID(first) || !sameShape(value, first)) dense = false;
+      if (!value || !mxIsChar(value) || !isPlain(value) || mxGetM(value) > 1) string = false;
+      if (!value || !mxIsStruct(value) || !sameShape(value, first) || !sameFields(value, first)) structure = false;
+      if (!value || !mxIsCell(value) || !sameShape(value, first)) cell = false;
+    }
+
+    // strings: dictionary of distinct values and one index per value
+    if (string) {
+      std::map<std::string, uint32_t> dictionary;
+      std::vector<std::string> entries;
+      std::vector<uint32_t> indices;
+      indices.reserve(values.size());
+      for(Values::const_iterator it = values.begin(); it != values.end(); ++it) {
+        std::string entry(static_cast<const char *>(mxGetData(*it)), mxGetNumberOfElements(*it) * sizeof(mxChar));
+        entry.insert(0, 1, mxGetM(*it) ? '\1' : '\0');
+        std::map<std::string, uint32_t>::iterator found = dictionary.find(entry);
+        if (found == dictionary.end()) {
+          found = dictionary.insert(std::make_pair(entry, static_cast<uint32_t>(entries.size()))).first;
+          entries.push_back(entry);
+        }
+        indices.push_back(found->second);
+      }
+
+      writer.write(uint32_t(COLUMN_STRING));
+      writer.write(static_cast<uint32_t>(entries.size()));
+      for(std::vector<std::string>::const_iterator it = entries.begin(); it != entries.end(); ++it) writer.write(*it);
+      writer.align(4);
+      if (!indices.empty()) writer.write(indices.data(), indices.size() * sizeof(uint32_t));
+      writer.align(8);
+      return true;
+    }
+
+    // numeric values of equal class and size: one contiguous array
+    if (dense) {
+      writer.write(uint32_t(COLUMN_DENSE));
+      writer.write(static_cast<uint32_t>(mxGetClassID(first)));
+      writer.write(static_cast<uint32_t>(mxGetM(first)));
+      writer.write(static_cast<uint32_t>(mxGetN(first)));
+      writer.align(8);
+      std::size_t size = mxGetNumberOfElements(first) * mxGetElementSize(first);
+      for(Values::const_iterator it = values.begin(); it != values.end(); ++it) writer.write(mxGetData(*it), size);
+      writer.align(8);
+      return true;
+    }
+
+    // structs with equal fields: one column per field
+    if (structure || cell) {
+      std::size_t numel = mxGetNumberOfElements(first);
+      writer.write(uint32_t(structure ? COLUMN_STRUCT : COLUMN_CELL));
+      writer.write(static_cast<uint32_t>(mxGetM(first)));
+      writer.write(static_cast<uint32_t>(mxGetN(first)));
+      if (structure) {
+        int fields = mxGetNumberOfFields(first);
+        writer.write(static_cast<uint32_t>(fields));
+        for(int j = 0; j < fields; ++j) writer.write(std::string(mxGetFieldNameByNumber(first, j)));
+        writer.align(8);
+
+        Values column(values.size() * numel);
+        for(int j = 0; j < fields; ++j) {
+          for(std::size_t i = 0; i < values.size(); ++i)
+            for(std::size_t k = 0; k < numel; ++k) column[i * numel + k] = mxGetFieldByNumber(values[i], k, j);
+          if (!encode(writer, column)) return false;
+        }
+      } else {
+        writer.align(8);
+        Values column(values.size() * numel);
+        for(std::size_t i = 0; i < values.size(); ++i)
+          for(std::size_t k = 0; k < numel; ++k) column[i * numel + k] = mxGetCell(values[i], k);
+        if (!encode(writer, column)) return false;
+      }
+      return true;
+    }
+
+    // numeric values of varying size (or missing values): shapes followed by the concatenated data
+    if (ragged) {
+      writer.write(uint32_t(COLUMN_RAGGED));
+      for(Values::const_iterator it = values.begin(); it != values.end(); ++it) {
+        writer.write(static_cast<uint32_t>(*it ? mxGetClassID(*it) : mxUNKNOWN_CLASS));
+        writer.write(static_cast<uint32_t>(*it ? mxGetM(*it) : 0));
+        writer.write(static_cast<uint32_t>(*it ? mxGetN(*it) : 0));
+      }
+      writer.align(8);
+      for(Values::const_iterator it = values.begin(); it != values.end(); ++it) {
+        if (!*it) continue;
+        writer.write(mxGetData(*it), mxGetNumberOfElements(*it) * mxGetElementSize(*it));
+        writer.align(8);
+      }
+      return true;
+    }
+
+    return false;
+  }
+
+  // read a column of n values
+  void decode(Reader& reader, std::size_t n, Arrays& values)
+  {
+    values.assign(n, 0);
+    uint32_t type = reader.readUInt32();
+
+    switch(type) {
+      case COLUMN_STRING: {
+        std::vector<std::string> entries(reader.readUInt32());
+        for(std::vector<std::string>::iterator it = entries.begin(); it != entries.end(); ++it) {
+          *it = reader.readString();
+          if (it->empty()) throw Exception("Cache", "invalid string entry");
+        }
+        reader.align(4);
+        const uint8_t *indices = reader.read(n * sizeof(uint32_t));
+        reader.align(8);
+
+        for(std::size_t i = 0; i < n; ++i) {
+          uint32_t index;
+          std::memcpy(&index, indices + i * sizeof(uint32_t), sizeof(index));
+          if (index >= entries.size()) throw Exception("Cache", "invalid string index");
+          const std::string &entry = entries[index];
+          std::size_t length = (entry.size() - 1) / sizeof(mxChar);
+          values[i] = createArray(mxCHAR_CLASS, entry[0] ? 1 : 0, length);
+          if (length) std::memcpy(mxGetData(values[i]), entry.data() + 1, length * sizeof(mxChar));
+        }
+        break;
+      }
+
+      case COLUMN_DENSE: {
+        mxClassID class_id = static_cast<mxClassID>(reader.readUInt32());
+        std::size_t rows = reader.readUInt32();
+        std::size_t cols = reader.readUInt32();
+        reader.align(8);
+        std::size_t size = rows * cols * elementSize(class_id);
+        const uint8_t *data = reader.read(n * size);
+        reader.align(8);
+
+        for(std::size_t i = 0; i < n; ++i) {
+          values[i] = createArray(class_id, rows, cols);
+          if (size) std::memcpy(mxGetData(values[i]), data + i * size, size);
+        }
+        break;
+      }
+
+      case COLUMN_STRUCT:
+      case COLUMN_CELL: {
+        std::size_t rows = reader.readUInt32();
+        std::size_t cols = reader.readUInt32();
+        std::size_t numel = rows * cols;
+        Arrays column;
+
+        if (type == COLUMN_STRUCT) {
+          std::vector<std::string> names(reader.readUInt32());
+          std::vector<const char *> fieldnames(names.size());
+          for(std::size_t j = 0; j < names.size(); ++j) {
+            names[j] = reader.readString();
+            fieldnames[j] = names[j].c_str();
+          }
+          reader.align(8);
+
+          for(std::size_t i = 0; i < n; ++i) values[i] = mxCreateStructMatrix(rows, cols, fieldnames.size(), fieldnames.data());
+          for(std::size_t j = 0; j < names.size(); ++j) {
+            decode(reader, n * numel, column);
+            for(std::size_t i = 0; i < n; ++i)
+              for(std::size_t k = 0; k < numel; ++k) mxSetFieldByNumber(values[i], k, j, column[i * numel + k]);
+          }
+        } else {
+          reader.align(8);
+          decode(reader, n * numel, column);
+          for(std::size_t i = 0; i < n; ++i) {
+            values[i] = mxCreateCellMatrix(rows, cols);
+            for(std::size_t k = 0; k < numel; ++k) mxSetCell(values[i], k, column[i * numel + k]);
+          }
+        }
+        break;
+      }
+
+      case COLUMN_RAGGED: {
+        std::vector<uint32_t> shapes(3 * n);
+        if (n) std::memcpy(shapes.data(), reader.read(shapes.size() * sizeof(uint32_t)), shapes.size() * sizeof(uint32_t));
+        reader.align(8);
+
+        for(std::size_t i = 0; i < n; ++i) {
+          mxClassID class_id = static_cast<mxClassID>(shapes[3 * i]);
+          if (class_id == mxUNKNOWN_CLASS) continue;
+          values[i] = createArray(class_id, shapes[3 * i + 1], shapes[3 * i + 2]);
+          std::size_t size = mxGetNumberOfElements(values[i]) * elementSize(class_id);
+          if (size) std::memcpy(mxGetData(values[i]), reader.read(size), size);
+          reader.align(8);
+        }
+        break;
+      }
+
+      default:
+        throw Exception("Cache", "invalid column type");
+    }
+  }
+}
+
+Cache::Cache(const std::string& bag_filename)
+  : directory_(bag_filename + ".rosmatlab")
+  , bag_size_(0)
+  , bag_mtime_(0)
+{
+  struct stat st;
+  if (::stat(bag_filename.c_str(), &st) < 0) throw Exception("Cache", "could not stat " + bag_filename + ": " + std::strerror(errno));
+  bag_size_ = st.st_size;
+  bag_mtime_ = st.st_mtime;
+}
+
+Cache::~Cache()
+{
+}
+
+std::string Cache::key(const std::string& topic_key) const
+{
+  return "size=" + boost::lexical_cast<std::string>(bag_size_) + ";mtime=" + boost::lexical_cast<std::string>(bag_mtime_) + ";" + topic_key;
+}
+
+std::string Cache::filename(const std::string& topic) const
+{
+  // escape everything but alphanumeric characters and underscores
+  std::string name;
+  for(std::string::const_iterator c = topic.begin(); c != topic.end(); ++c) {
+    if (std::isalnum(*c) || *c == '_') { name += *c; continue; }
+    char escaped[4];
+    std::snprintf(escaped, sizeof(escaped), "%%%02X", static_cast<unsigned char>(*c));
+    name += escaped;
+  }
+  return directory_ + "/" + name + ".columns";
+}
+
+mxArray *Cache::read(const std::string& topic, const std::string& key) const
+{
+  std::string filename = this->filename(topic);
+  struct stat st;
+  if (::stat(filename.c_str(), &st) < 0 || st.st_size == 0) return 0;
+
+  // arrays created before a failure are freed by Matlab when the MEX function returns
+  try {
+    MappedFile file(filename);
+    file.advise(MappedFile::SEQUENTIAL);
+    Reader reader(file.data(), file.size());
+
+    if (std::memcmp(reader.read(sizeof(MAGIC)), MAGIC, sizeof(MAGIC)) != 0) return 0;
+    if (reader.readString() != key) return 0;
+    reader.align(8);
+
+    Arrays values;
+    decode(reader, 1, values);
+    return values.front();
+
+  } catch(Exception &e) {
+    return 0;
+  }
+}
+
+bool Cache::write(const std::string& topic, const std::string& key, const mxArray *value) const
+{
+  if (::mkdir(directory_.c_str(), 0755) < 0 && errno != EEXIST) return false;
+
+  // write to a temporary file first, so that readers never see a partial entry
+  std::string filename = this->filename(topic);
+  std::string temporary = filename + ".tmp";
+  bool success;
+  {
+    std::ofstream stream(temporary.c_str(), std::ios::out | std::ios::binary | std::ios::trunc);
+    if (!stream) return false;
+
+    Writer writer(stream);
+    writer.write(MAGIC, sizeof(MAGIC));
+    writer.write(key);
+    writer.align(8);
+    success = encode(writer, Values(1, value)) && stream.good();
+  }
+
+  if (!success || std::rename(temporary.c_str(), filename.c_str()) < 0) {
+    std::remove(temporary.c_str());
+    return false;
+  }
+  return true;
+}
+
+} // namespace rosbag
+} // namespace rosmatlab
@@ -0,0 +1,259 @@
+//=================================================================================================
+// Copyright (c) 2013, Johannes Meyer, TU Darmstadt
+// All rights reserved.
+
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//     * Redistributions of source code must retain the above copyright
+//       notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above copyright
+//       notice, this list of conditions and the following disclaimer in the
+//       documentation and/or other materials provided with the distribution.
+//     * Neither the name of the Flight Systems and Automatic Control group,
+//       TU Darmstadt, nor the names of its contributors may be used to
+//       endorse or promote products derived from this software without
+//       specific prior written permission.
+
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+// ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+// WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER BE LIABLE FOR ANY
+// DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+// (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+// LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+// ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+// SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+//=================================================================================================
+
+
+#include <rosmatlab/rosbag/dynamic_decoder.h>
+#include <rosmatlab/rosbag/message_span.h>
+
+#include <rosmatlab/exception.h>
+#include <rosmatlab/conversion.h>
+
+#include <boost/algorithm/string/trim.hpp>
+#include <boost/thread/mutex.hpp>
+
+#include <cstdlib>
+#include <cstring>
+#include <map>
+#include <sstream>
+
+namespace rosmatlab {
+namespace rosbag {
+
+namespace {
+  struct Primitive {
+    const char *name;
+    DynamicDecoder::Type type;
+  };
+
+  const Primitive primitives[] = {
+    { "bool", DynamicDecoder::BOOL },
+    { "int8", DynamicDecoder::INT8 },       { "byte", DynamicDecoder::INT8 },
+    { "uint8", DynamicDecoder::UINT8 },     { "char", DynamicDecoder::UINT8 },
+    { "int16", DynamicDecoder::INT16 },     { "uint16", DynamicDecoder::UINT16 },
+    { "int32", DynamicDecoder::INT32 },     { "uint32", DynamicDecoder::UINT32 },
+    { "int64", DynamicDecoder::INT64 },     { "uint64", DynamicDecoder::UINT64 },
+    { "float32", DynamicDecoder::FLOAT32 }, { "float64", DynamicDecoder::FLOAT64 },
+    { "string", DynamicDecoder::STRING },
+    { "time", DynamicDecoder::TIME },       { "duration", DynamicDecoder::DURATION },
+  };
+
+  // splits a full message definition into the definitions of the top-level and all nested types
+  class DefinitionParser {
+  public:
+    DefinitionParser(const std::string& datatype, const std::string& definition) {
+      std::istringstream stream(definition);
+      std::string line, type = datatype, text;
+      while(std::getline(stream, line)) {
+        if (line.compare(0, 3, "===") == 0) {
+          sections_[type] = text;
+          type.clear();
+          text.clear();
+          continue;
+        }
+        if (type.empty() && line.compare(0, 4, "MSG:") == 0) {
+          type = boost::algorithm::trim_copy(line.substr(4));
+          continue;
+        }
+        text += line + "\n";
+      }
+      if (!type.empty()) sections_[type] = text;
+    }
+
+    DynamicDecoderPtr build(const std::string& datatype, const std::string& md5sum) {
+      if (decoders_.count(datatype)) return decoders_[datatype];
+      if (!sections_.count(datatype)) throw Exception("DynamicDecoder", "the message definition does not contain " + datatype);
+
+      DynamicDecoderPtr decoder(new DynamicDecoder(datatype, md5sum));
+      decoders_[datatype] = decoder;
+      std::string package = datatype.substr(0, datatype.find('/'));
+
+      std::istringstream stream(sections_[datatype]);
+      std::string line;
+      while(std::getline(stream, line)) {
+        std::string::size_type comment = line.find('#');
+        std::string::size_type equal = line.find('=');
+        if (equal != std::string::npos && equal < comment) continue;  // constant
+        if (comment != std::string::npos) line.erase(comment);
+        boost::algorithm::trim(line);
+        if (line.empty()) continue;
+
+        std::istringstream tokens(line);
+        std::string type, name;
+        tokens >> type >> name;
+        if (name.empty()) throw Exception("DynamicDecoder", "cannot parse '" + line + "' in the definition of " + datatype);
+
+        DynamicDecoder::Field field;
+        field.name = name;
+        field.length = -1;
+        std::string::size_type bracket = type.find('[');
+        if (bracket != std::string::npos) {
+          field.length = std::atoi(type.substr(bracket + 1).c_str());
+          type.erase(bracket);
+        }
+
+        field.type = DynamicDecoder::MESSAGE;
+        for(std::size_t i = 0; i < sizeof(primitives) / sizeof(*primitives); ++i) {
+          if (type == primitives[i].name) field.type = primitives[i].type;
+        }
+        if (field.type == DynamicDecoder::MESSAGE) {
+          if (type == "Header") type = "std_msgs/Header";
+          else if (type.find('/') == std::string::npos) type = package + "/" + type;
+          field.message = build(type, std::string());
+        }
+
+        decoder->addField(field);
+      }
+      return decoder;
+    }
+
+  private:
+    std::map<std::string, std::string> sections_;
+    std::map<std::string, DynamicDecoderPtr> decoders_;
+  };
+
+  template <typename T> T read(const uint8_t *&data, const uint8_t *end) {
+    if (data + sizeof(T) > end) throw Exception("DynamicDecoder", "message is truncated");
+    T value;
+    std::memcpy(&value, data, sizeof(T));
+    data += sizeof(T);
+    return value;
+  }
+
+  double readDouble(DynamicDecoder::Type type, const uint8_t *&data, const uint8_t *end) {
+    switch(type) {
+      case DynamicDecoder::BOOL:
+      case DynamicDecoder::UINT8:   return read<uint8_t>(data, end);
+      case DynamicDecoder::INT8:    return read<int8_t>(data, end);
+      case DynamicDecoder::INT16:   return read<int16_t>(data, end);
+      case DynamicDecoder::UINT16:  return read<uint16_t>(data, end);
+      case DynamicDecoder::INT32:   return read<int32_t>(data, end);
+      case DynamicDecoder::UINT32:  return read<uint32_t>(data, end);
+      case DynamicDecoder::INT64:   return static_cast<double>(read<int64_t>(data, end));
+      case DynamicDecoder::UINT64:  return static_cast<double>(read<uint64_t>(data, end));
+      case DynamicDecoder::FLOAT32: return read<float>(data, end);
+      case DynamicDecoder::FLOAT64: return read<double>(data, end);
+      case DynamicDecoder::TIME:     { uint32_t sec = read<uint32_t>(data, end); uint32_t nsec = read<uint32_t>(data, end); return sec + 1e-9 * nsec; }
+      case DynamicDecoder::DURATION: { int32_t sec = read<int32_t>(data, end); int32_t nsec = read<int32_t>(data, end); return sec + 1e-9 * nsec; }
+      default: break;
+    }
+    throw Exception("DynamicDecoder", "not a numeric type");
+  }
+
+  std::string readString(const uint8_t *&data, const uint8_t *end) {
+    uint32_t length = read<uint32_t>(data, end);
+    if (data + length > end) throw Exception("DynamicDecoder", "message is truncated");
+    std::string value(reinterpret_cast<const char *>(data), length);
+    data += length;
+    return value;
+  }
+
+  boost::mutex cache_mutex;
+  std::map<std::string, DynamicDecoderPtr> cache;
+}
+
+DynamicDecoder::DynamicDecoder(const std::string& datatype, const std::string& md5sum)
+  : datatype_(datatype)
+  , md5sum_(md5sum)
+{
+}
+
+DynamicDecoder::~DynamicDecoder()
+{
+}
+
+DynamicDecoderPtr DynamicDecoder::get(const std::string& datatype, const std::string& md5sum, const std::string& definition)
+{
+  // a definition that cannot be parsed is reported once and cached as a null decoder
+  boost::mutex::scoped_lock lock(cache_mutex);
+  std::string key = datatype + "/" + md5sum;
+  std::map<std::string, DynamicDecoderPtr>::const_iterator found = cache.find(key);
+  if (found != cache.end()) return found->second;
+
+  DynamicDecoderPtr &decoder = cache[key];
+  decoder = DefinitionParser(datatype, definition).build(datatype, md5sum);
+  return decoder;
+}
+
+void DynamicDecoder::addField(const Field& field)
+{
+  fields_.push_back(field);
+  fieldnames_.clear();
+  for(std::vector<Field>::const_iterator it = fields_.begin(); it != fields_.end(); ++it) fieldnames_.push_back(it->name.c_str());
+}
+
+mxArray *DynamicDecoder::toMatlab(const MessageSpan& span, mxArray *target, std::size_t index, std::size_t size) const
+{
+  const uint8_t *data = span.data;
+  target = decode(data, span.data + span.size, target, index, size);
+
+  // add meta data to the struct
+  if (Conversion::defaultOptions().addMetaData()) {
+    if (mxGetFieldNumber(target, "DATATYPE") == -1) mxAddField(target, "DATATYPE");
+    mxSetField(target, index, "DATATYPE", mxCreateString(datatype_.c_str()));
+    if (mxGetFieldNumber(target, "MD5SUM") == -1) mxAddField(target, "MD5SUM");
+    mxSetField(target, index, "MD5SUM", mxCreateString(md5sum_.c_str()));
+  }
+
+  return target;
+}
+
+mxArray *DynamicDecoder::decode(const uint8_t *&data, const uint8_t *end, mxArray *target, std::size_t index, std::size_t size) const
+{
+  if (!target) target = mxCreateStructMatrix(1, size > 0 ? size : index + 1, fieldnames_.size(), const_cast<const char **>(fieldnames_.data()));
+  for(std::vector<Field>::const_iterator field = fields_.begin(); field != fields_.end(); ++field) {
+    mxSetField(target, index, field->name.c_str(), decodeField(*field, data, end));
+  }
+  return target;
+}
+
+mxArray *DynamicDecoder::decodeField(const Field& field, const uint8_t *&data, const uint8_t *end) const
+{
+  std::size_t count = (field.length > 0) ? field.length : (field.length == 0 ? read<uint32_t>(data, end) : 1);
+  if (field.type != MESSAGE && count > static_cast<std::size_t>(end - data)) throw Exception("DynamicDecoder", "message is truncated");
+
+  if (field.type == MESSAGE) {
+    mxArray *target = 0;
+    for(std::size_t i = 0; i < count; ++i) target = field.message->decode(data, end, target, i, count);
+    return target;
+  }
+
+  if (field.type == STRING) {
+    if (field.length < 0) return mxCreateString(readString(data, end).c_str());
+    mxArray *target = mxCreateCellMatrix(1, count);
+    for(std::size_t i = 0; i < count; ++i) mxSetCell(target, i, mxCreateString(readString(data, end).c_str()));
+    return target;
+  }
+
+  mxArray *target = mxCreateDoubleMatrix(1, count, mxREAL);
+  double *x = mxGetPr(target);
+  for(std::size_t i = 0; i < count; ++i) x[i] = readDouble(field.type, data, end);
+  return target;
+}
+
+} // namespace rosbag
+} // namespace rosmatlab
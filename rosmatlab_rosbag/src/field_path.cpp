@@ -0,0 +1,134 @@
+//=================================================================================================
+// Copyright (c) 2013, Johannes Meyer, TU Darmstadt
+// All rights reserved.
+
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//     * Redistributions of source code must retain the above copyright
+//       notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above copyright
+//       notice, this list of conditions and the following disclaimer in the
+//       documentation and/or other materials provided with the distribution.
+//     * Neither the name of the Flight Systems and Automatic Control group,
+//       TU Darmstadt, nor the names of its contributors may be used to
+//       endorse or promote products derived from this software without
+//       specific prior written permission.
+
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+// ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+// WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER BE LIABLE FOR ANY
+// DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+// (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+// LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+// ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+// SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+//=================================================================================================
+
+
+#include <rosmatlab/rosbag/field_path.h>
+#include <rosmatlab/exception.h>
+
+#include <introspection/message.h>
+#include <introspection/type.h>
+
+#include <boost/lexical_cast.hpp>
+
+#include <cctype>
+#include <cstdlib>
+#include <iterator>
+
+namespace rosmatlab {
+namespace rosbag {
+
+using namespace cpp_introspection;
+
+FieldPath::FieldPath()
+{
+}
+
+FieldPath::FieldPath(const std::string& path)
+{
+  std::size_t pos = 0;
+  *this = parse(path, pos);
+  if (pos != path.size()) throw Exception("FieldPath", "unexpected input at position " + boost::lexical_cast<std::string>(pos + 1) + " of '" + path + "'");
+}
+
+FieldPath FieldPath::parse(const std::string& text, std::size_t& pos)
+{
+  FieldPath path;
+  do {
+    std::size_t begin = pos;
+    while(pos < text.size() && (std::isalnum(text[pos]) || text[pos] == '_')) pos++;
+    if (pos == begin || std::isdigit(text[begin])) throw Exception("FieldPath", "expected field name at position " + boost::lexical_cast<std::string>(pos + 1) + " of '" + text + "'");
+
+    Element element;
+    element.name = text.substr(begin, pos - begin);
+    element.index = -1;
+    if (pos < text.size() && text[pos] == '[') {
+      std::size_t digits = ++pos;
+      while(pos < text.size() && std::isdigit(text[pos])) pos++;
+      if (pos == digits || pos == text.size() || text[pos] != ']') throw Exception("FieldPath", "expected array index at position " + boost::lexical_cast<std::string>(digits + 1) + " of '" + text + "'");
+      element.index = std::atoi(text.substr(digits, pos - digits).c_str());
+      pos++;
+    }
+    path.elements_.push_back(element);
+  } while(pos < text.size() && text[pos] == '.' && ++pos);
+
+  return path;
+}
+
+std::string FieldPath::toString() const
+{
+  std::string result;
+  for(std::vector<Element>::const_iterator it = elements_.begin(); it != elements_.end(); ++it) {
+    if (it != elements_.begin()) result += ".";
+    result += it->name;
+    if (it->index >= 0) result += "[" + boost::lexical_cast<std::string>(it->index) + "]";
+  }
+  return result;
+}
+
+FieldPtr FieldPath::resolve(const MessagePtr& message, std::size_t step) const
+{
+  std::pair<std::string, std::size_t> key(message->getDataType(), step);
+  std::map<std::pair<std::string, std::size_t>, std::size_t>::const_iterator cached = positions_.find(key);
+  Message::const_iterator it = message->begin();
+  if (cached != positions_.end()) {
+    std::advance(it, cached->second);
+    return *it;
+  }
+
+  for(std::size_t position = 0; it != message->end(); ++it, ++position) {
+    if (elements_[step].name == (*it)->getName()) {
+      positions_[key] = position;
+      return *it;
+    }
+  }
+  throw Exception("FieldPath", "message type " + std::string(message->getDataType()) + " has no field " + elements_[step].name);
+}
+
+bool FieldPath::getDouble(const MessagePtr& message, double& value) const
+{
+  MessagePtr current = message;
+  for(std::size_t step = 0; step < elements_.size(); ++step) {
+    FieldPtr field = resolve(current, step);
+    std::size_t index = elements_[step].index >= 0 ? elements_[step].index : 0;
+    if (index >= field->size()) return false;
+
+    if (step + 1 < elements_.size()) {
+      if (!field->isMessage()) throw Exception("FieldPath", "field " + elements_[step].name + " is not a message");
+      current = field->expand(index);
+      if (!current) return false;
+      continue;
+    }
+
+    if (field->isMessage() || field->getType()->isString()) throw Exception("FieldPath", "field " + toString() + " is not numeric");
+    value = field->getType()->as_double(field->get(index));
+  }
+  return true;
+}
+
+} // namespace rosbag
+} // namespace rosmatlab
@@ -0,0 +1,160 @@
+//=================================================================================================
+// Copyright (c) 2013, Johannes Meyer, TU Darmstadt
+// All rights reserved.
+
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//     * Redistributions of source code must retain the above copyright
+//       notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above copyright
+//       notice, this list of conditions and the following disclaimer in the
+//       documentation and/or other materials provided with the distribution.
+//     * Neither the name of the Flight Systems and Automatic Control group,
+//       TU Darmstadt, nor the names of its contributors may be used to
+//       endorse or promote products derived from this software without
+//       specific prior written permission.
+
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+// ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+// WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER BE LIABLE FOR ANY
+// DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+// (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+// LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+// ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+// SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+//=================================================================================================
+
+
+#include <rosmatlab/rosbag/mapped_file.h>
+#include <rosmatlab/exception.h>
+
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <cstring>
+
+namespace rosmatlab {
+namespace rosbag {
+
+namespace {
+  uint32_t readUInt32(const uint8_t *p)
+  {
+    uint32_t value;
+    std::memcpy(&value, p, sizeof(value));
+    return value;
+  }
+}
+
+MappedFile::MappedFile(const std::string &filename)
+  : data_(0)
+  , size_(0)
+{
+  int fd = ::open(filename.c_str(), O_RDONLY);
+  if (fd < 0) throw Exception("MappedFile", "could not open " + filename + ": " + std::strerror(errno));
+
+  struct stat st;
+  if (::fstat(fd, &st) < 0) {
+    ::close(fd);
+    throw Exception("MappedFile", "could not stat " + filename + ": " + std::strerror(errno));
+  }
+
+  size_ = st.st_size;
+  void *mapping = ::mmap(0, size_, PROT_READ, MAP_SHARED, fd, 0);
+  ::close(fd);
+  if (mapping == MAP_FAILED) throw Exception("MappedFile", "could not map " + filename + ": " + std::strerror(errno));
+  data_ = static_cast<uint8_t *>(mapping);
+}
+
+MappedFile::~MappedFile()
+{
+  if (data_) ::munmap(data_, size_);
+}
+
+void MappedFile::advise(Access access) const
+{
+  int advice = MADV_NORMAL;
+  if (access == SEQUENTIAL) advice = MADV_SEQUENTIAL;
+  if (access == RANDOM)     advice = MADV_RANDOM;
+  ::madvise(data_, size_, advice);
+}
+
+bool MappedFile::findField(const uint8_t *header, uint32_t header_length, const std::string &name, std::string &value)
+{
+  const uint8_t *end = header + header_length;
+  while(header + 4 <= end) {
+    uint32_t length = readUInt32(header);
+    header += 4;
+    if (length > static_cast<uint32_t>(end - header)) break;
+
+    const uint8_t *separator = static_cast<const uint8_t *>(std::memchr(header, '=', length));
+    if (separator && static_cast<std::size_t>(separator - header) == name.size() && std::memcmp(header, name.data(), name.size()) == 0) {
+      value.assign(reinterpret_cast<const char *>(separator + 1), header + length - separator - 1);
+      return true;
+    }
+    header += length;
+  }
+  return false;
+}
+
+uint64_t MappedFile::readRecord(uint64_t pos, const uint8_t *&header, uint32_t &header_length, const uint8_t *&data, uint32_t &data_length) const
+{
+  if (pos + 4 > size_) throw Exception("MappedFile", "record header out of bounds");
+  header_length = readUInt32(data_ + pos);
+  header = data_ + pos + 4;
+  pos += 4 + header_length;
+
+  if (pos + 4 > size_) throw Exception("MappedFile", "record data out of bounds");
+  data_length = readUInt32(data_ + pos);
+  data = data_ + pos + 4;
+  pos += 4 + data_length;
+  if (pos > size_) throw Exception("MappedFile", "record data out of bounds");
+
+  return pos;
+}
+
+const MappedFile::Chunk& MappedFile::chunk(uint64_t chunk_pos) const
+{
+  std::map<uint64_t, Chunk>::const_iterator it = chunks_.find(chunk_pos);
+  if (it != chunks_.end()) return it->second;
+
+  const uint8_t *header, *data;
+  uint32_t header_length, data_length;
+  readRecord(chunk_pos, header, header_length, data, data_length);
+
+  Chunk chunk;
+  std::string size;
+  if (!findField(header, header_length, "compression", chunk.compression) || !findField(header, header_length, "size", size) || size.size() != 4)
+    throw Exception("MappedFile", "invalid chunk header");
+  chunk.compressed_size = data_length;
+  chunk.uncompressed_size = readUInt32(reinterpret_cast<const uint8_t *>(size.data()));
+  chunk.data_offset = data - data_;
+
+  return chunks_[chunk_pos] = chunk;
+}
+
+bool MappedFile::isCompressed(uint64_t chunk_pos) const
+{
+  return chunk(chunk_pos).compression != "none";
+}
+
+bool MappedFile::span(const ::rosbag::IndexEntry &entry, MessageSpan &span) const
+{
+  const Chunk &c = chunk(entry.chunk_pos);
+  if (c.compression != "none") return false;
+  if (entry.offset >= c.uncompressed_size) throw Exception("MappedFile", "message offset out of bounds");
+
+  const uint8_t *header, *data;
+  uint32_t header_length, data_length;
+  readRecord(c.data_offset + entry.offset, header, header_length, data, data_length);
+
+  span = MessageSpan(const_cast<uint8_t *>(data), data_length);
+  return true;
+}
+
+} // namespace rosbag
+} // namespace rosmatlab
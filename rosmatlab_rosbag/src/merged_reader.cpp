@@ -0,0 +1,246 @@
+//=================================================================================================
+// Copyright (c) 2013, Johannes Meyer, TU Darmstadt
+// All rights reserved.
+
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//     * Redistributions of source code must retain the above copyright
+//       notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above copyright
+//       notice, this list of conditions and the following disclaimer in the
+//       documentation and/or other materials provided with the distribution.
+//     * Neither the name of the Flight Systems and Automatic Control group,
+//       TU Darmstadt, nor the names of its contributors may be used to
+//       endorse or promote products derived from this software without
+//       specific prior written permission.
+
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+// ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+// WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER BE LIABLE FOR ANY
+// DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+// (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+// LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+// ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+// SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+//=================================================================================================
+
+
+#include <rosmatlab/rosbag/merged_reader.h>
+#include <rosmatlab/rosbag/message_span.h>
+#include <rosmatlab/exception.h>
+#include <rosmatlab/log.h>
+
+#include <rosbag/bag.h>
+#include <rosbag/view.h>
+
+#include <introspection/message.h>
+
+#include <boost/bind.hpp>
+
+#include <algorithm>
+
+namespace rosmatlab {
+namespace rosbag {
+
+MergedReader::MergedReader(std::size_t prefetch)
+  : prefetch_(prefetch > 0 ? prefetch : 1)
+  , group_(0)
+  , primed_(false)
+  , stop_(false)
+{
+}
+
+MergedReader::~MergedReader()
+{
+  {
+    boost::mutex::scoped_lock lock(mutex_);
+    stop_ = true;
+  }
+  changed_.notify_all();
+  threads_.join_all();
+}
+
+void MergedReader::addQuery(const std::string& filename, const ::rosbag::Query& query, const ros::Time& begin, const ros::Time& end)
+{
+  std::map<std::string, std::size_t>::iterator found = filenames_.find(filename);
+  if (found == filenames_.end()) {
+    Source source;
+    source.filename = filename;
+    source.begin = begin;
+    source.end = end;
+    source.started = false;
+    source.done = false;
+    found = filenames_.insert(std::make_pair(filename, sources_.size())).first;
+    sources_.push_back(source);
+  }
+
+  Source &source = sources_[found->second];
+  source.queries.push_back(query);
+  source.begin = std::min(source.begin, begin);
+  source.end = std::max(source.end, end);
+}
+
+void MergedReader::addConnection(const ConnectionInfo *connection)
+{
+  topics_.insert(connection->topic);
+
+  // introspection lookups are done in advance, the workers only read from types_
+  if (types_.count(connection->md5sum)) return;
+  types_[connection->md5sum] = cpp_introspection::messageByMD5Sum(connection->md5sum);
+  if (types_[connection->md5sum]) return;
+
+  // datatypes without introspection are decoded from the definition in the bag
+  try {
+    decoders_[connection->md5sum] = DynamicDecoder::get(connection->datatype, connection->md5sum, connection->msg_def);
+  } catch(Exception& e) {
+    ROSMATLAB_WARN("%s", e.what());
+  }
+}
+
+bool MergedReader::accept(const boost::function<bool(const ConnectionInfo *)>& query, const ConnectionInfo *connection) const
+{
+  return topics_.count(connection->topic) && query(connection);
+}
+
+void MergedReader::group()
+{
+  // sort the bags by their first message and group them while their time ranges overlap
+  std::vector<std::pair<ros::Time, std::size_t> > order;
+  for(std::size_t i = 0; i < sources_.size(); ++i) order.push_back(std::make_pair(sources_[i].begin, i));
+  std::sort(order.begin(), order.end());
+
+  ros::Time group_end;
+  for(std::size_t i = 0; i < order.size(); ++i) {
+    const Source &source = sources_[order[i].second];
+    if (groups_.empty() || source.begin > group_end) {
+      groups_.push_back(std::vector<std::size_t>());
+      group_end = source.end;
+    }
+    groups_.back().push_back(order[i].second);
+    group_end = std::max(group_end, source.end);
+  }
+}
+
+void MergedReader::startGroup(std::size_t group)
+{
+  if (group >= groups_.size()) return;
+  for(std::vector<std::size_t>::const_iterator it = groups_[group].begin(); it != groups_[group].end(); ++it) {
+    if (sources_[*it].started) continue;
+    sources_[*it].started = true;
+    threads_.create_thread(boost::bind(&MergedReader::work, this, *it));
+  }
+}
+
+bool MergedReader::wait(std::size_t source, ros::Time& time)
+{
+  // wait until the next message of a bag is available or the bag is finished
+  boost::mutex::scoped_lock lock(mutex_);
+  while(sources_[source].queue.empty() && !sources_[source].done && error_.empty()) changed_.wait(lock);
+  if (!error_.empty()) throw Exception("MergedReader", error_);
+  if (sources_[source].queue.empty()) return false;
+  time = sources_[source].queue.front().time;
+  return true;
+}
+
+bool MergedReader::next(Entry& entry)
+{
+  if (groups_.empty()) group();
+
+  while(group_ < groups_.size()) {
+    if (!primed_) {
+      // the bags of the next group are prefetched while this group is consumed
+      startGroup(group_);
+      startGroup(group_ + 1);
+      heap_.clear();
+      for(std::vector<std::size_t>::const_iterator it = groups_[group_].begin(); it != groups_[group_].end(); ++it) {
+        Head head = { ros::Time(), *it };
+        if (wait(*it, head.time)) heap_.push_back(head);
+      }
+      std::make_heap(heap_.begin(), heap_.end());
+      primed_ = true;
+    }
+
+    if (heap_.empty()) {
+      group_++;
+      primed_ = false;
+      continue;
+    }
+
+    std::pop_heap(heap_.begin(), heap_.end());
+    Head head = heap_.back();
+    heap_.pop_back();
+
+    {
+      boost::mutex::scoped_lock lock(mutex_);
+      Source &source = sources_[head.source];
+      entry = source.queue.front();
+      source.queue.pop_front();
+    }
+    changed_.notify_all();
+
+    if (wait(head.source, head.time)) {
+      heap_.push_back(head);
+      std::push_heap(heap_.begin(), heap_.end());
+    }
+    return true;
+  }
+
+  return false;
+}
+
+void MergedReader::work(std::size_t index)
+{
+  Source &source = sources_[index];
+
+  try {
+    // every worker opens its own bag instance (declared before the view, which must be destroyed first)
+    ::rosbag::Bag bag(source.filename, ::rosbag::bagmode::Read);
+    ::rosbag::View view;
+    for(std::vector< ::rosbag::Query>::const_iterator it = source.queries.begin(); it != source.queries.end(); ++it) {
+      view.addQuery(bag, boost::bind(&MergedReader::accept, this, it->getQuery(), _1), it->getStartTime(), it->getEndTime());
+    }
+
+    for(::rosbag::View::iterator it = view.begin(); it != view.end(); ++it) {
+      Entry entry;
+      entry.topic = it->getTopic();
+      entry.time = it->getTime();
+
+      std::map<std::string, cpp_introspection::MessagePtr>::const_iterator type = types_.find(it->getMD5Sum());
+      if (type != types_.end() && type->second) {
+        boost::shared_ptr<MessageSpan> span = it->instantiate<MessageSpan>();
+        ros::serialization::IStream stream(span->data, span->size);
+        entry.introspection = type->second;
+        entry.instance = type->second->deserialize(stream);
+      } else {
+        std::map<std::string, DynamicDecoderPtr>::const_iterator decoder = decoders_.find(it->getMD5Sum());
+        if (decoder != decoders_.end() && decoder->second) {
+          boost::shared_ptr<MessageSpan> span = it->instantiate<MessageSpan>();
+          entry.decoder = decoder->second;
+          entry.buffer.assign(span->data, span->data + span->size);
+        }
+      }
+
+      boost::mutex::scoped_lock lock(mutex_);
+      while(source.queue.size() >= prefetch_ && !stop_) changed_.wait(lock);
+      if (stop_) return;
+      source.queue.push_back(entry);
+      lock.unlock();
+      changed_.notify_all();
+    }
+
+  } catch(std::exception &e) {
+    boost::mutex::scoped_lock lock(mutex_);
+    if (error_.empty()) error_ = source.filename + ": " + e.what();
+  }
+
+  {
+    boost::mutex::scoped_lock lock(mutex_);
+    source.done = true;
+  }
+  changed_.notify_all();
+}
+
+} // namespace rosbag
+} // namespace rosmatlab
@@ -39,8 +39,13 @@ void mexFunction(int nlhs, mxArray *plhs[], int nrhs, const mxArray *prhs[])
     methods
     .add("open",              &Bag::open)
     .add("close",             &Bag::close)
+    .add("reindex",           &Bag::reindex)
+    .add("save",              &Bag::save)
+    .add("flush",             &Bag::flush)
     .add("write",             &Bag::write)
+    .add("copy",              &Bag::copy)
     .add("data",              &Bag::data)
+    .add("info",              &Bag::info)
 
     .add("getFileName",       &Bag::getFileName)
     .add("getMode",           &Bag::getMode)
@@ -44,10 +44,14 @@ void mexFunction(int nlhs, mxArray *plhs[], int nrhs, const mxArray *prhs[])
     .add("valid",                &View::valid)
     .add("eof",                  &View::eof)
     .add("increment",            &View::increment)
+    .add("seek",                 &View::seek)
+    .add("seekIndex",            &View::seekIndex)
 
     .add("get",                  &View::get)
     .add("data",                 &View::data)
     .add("next",                 &View::next)
+    .add("resample",             &View::resample)
+    .add("save",                 &View::save)
 
     .add("getSize",              &View::getSize)
     .add("getTime",              &View::getTime)
@@ -0,0 +1,233 @@
+//=================================================================================================
+// Copyright (c) 2013, Johannes Meyer, TU Darmstadt
+// All rights reserved.
+
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//     * Redistributions of source code must retain the above copyright
+//       notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above copyright
+//       notice, this list of conditions and the following disclaimer in the
+//       documentation and/or other materials provided with the distribution.
+//     * Neither the name of the Flight Systems and Automatic Control group,
+//       TU Darmstadt, nor the names of its contributors may be used to
+//       endorse or promote products derived from this software without
+//       specific prior written permission.
+
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+// ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+// WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER BE LIABLE FOR ANY
+// DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+// (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+// LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+// ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+// SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+//=================================================================================================
+
+
+#include <rosmatlab/rosbag/parallel_reader.h>
+#include <rosmatlab/rosbag/message_span.h>
+
+#include <rosmatlab/exception.h>
+#include <rosmatlab/log.h>
+
+#include <rosbag/bag.h>
+#include <rosbag/view.h>
+
+#include <introspection/message.h>
+
+#include <boost/bind.hpp>
+
+#include <algorithm>
+
+namespace rosmatlab {
+namespace rosbag {
+
+ParallelReader::ParallelReader(unsigned int threads, std::size_t queue_bytes)
+  : threads_(threads)
+  , queue_bytes_(queue_bytes)
+  , queued_(0)
+  , claimed_(0)
+  , consumed_(0)
+  , stop_(false)
+{
+  unsigned int cores = boost::thread::hardware_concurrency();
+  if (threads_ == 0 || (cores > 0 && threads_ > cores)) threads_ = cores;
+  if (threads_ == 0) threads_ = 1;
+}
+
+ParallelReader::~ParallelReader()
+{
+  stop();
+}
+
+void ParallelReader::addQuery(const std::string &filename, const ::rosbag::Query &query)
+{
+  queries_.push_back(std::make_pair(filename, query));
+}
+
+void ParallelReader::addConnection(const ConnectionInfo *connection)
+{
+  topics_.insert(connection->topic);
+
+  // introspection lookups are done in advance, the workers only read from types_
+  if (types_.count(connection->md5sum)) return;
+  types_[connection->md5sum] = cpp_introspection::messageByMD5Sum(connection->md5sum);
+  if (types_[connection->md5sum]) return;
+
+  // datatypes without introspection are decoded from the definition in the bag
+  try {
+    decoders_[connection->md5sum] = DynamicDecoder::get(connection->datatype, connection->md5sum, connection->msg_def);
+  } catch(Exception& e) {
+    ROSMATLAB_WARN("%s", e.what());
+  }
+}
+
+bool ParallelReader::accept(const boost::function<bool(const ConnectionInfo *)>& query, const ConnectionInfo *connection) const
+{
+  return topics_.count(connection->topic) && query(connection);
+}
+
+void ParallelReader::read(const ros::Time &begin, const ros::Time &end, std::vector<ros::Time> chunks)
+{
+  stop();
+  ranges_.clear();
+  slices_.clear();
+  done_.clear();
+  bytes_.clear();
+  queued_ = claimed_ = consumed_ = 0;
+  stop_ = false;
+  error_.clear();
+  if (queries_.empty() || topics_.empty() || end < begin) return;
+
+  // the first chunk starts the first slice, later chunks can start a slice if they begin after begin
+  std::sort(chunks.begin(), chunks.end());
+  chunks.erase(std::unique(chunks.begin(), chunks.end()), chunks.end());
+  chunks.erase(chunks.begin(), std::upper_bound(chunks.begin(), chunks.end(), begin));
+  chunks.erase(std::upper_bound(chunks.begin(), chunks.end(), end), chunks.end());
+
+  // every slice holds the same number of chunks, at least four slices per thread so that conversion can start
+  // early, but at most 16 chunks (12 MB with the default chunk size) to keep the slices small on large bags
+  std::size_t per_slice = std::max<std::size_t>(1, std::min<std::size_t>(16, (chunks.size() + 1) / (4 * threads_)));
+  ros::Time slice_start = begin;
+  for(std::size_t i = per_slice; i <= chunks.size(); i += per_slice) {
+    ranges_.push_back(std::make_pair(slice_start, chunks[i - 1] - ros::Duration(0, 1)));
+    slice_start = chunks[i - 1];
+  }
+  ranges_.push_back(std::make_pair(slice_start, end));
+  slices_.resize(ranges_.size());
+  done_.resize(ranges_.size(), false);
+  bytes_.resize(ranges_.size(), 0);
+
+  for(unsigned int i = 0; i < threads_; ++i) workers_.create_thread(boost::bind(&ParallelReader::run, this));
+}
+
+bool ParallelReader::next(Entries &entries)
+{
+  entries.clear();
+  boost::mutex::scoped_lock lock(mutex_);
+  if (consumed_ >= slices_.size()) return false;
+  while(!done_[consumed_] && error_.empty()) changed_.wait(lock);
+  if (!error_.empty()) throw Exception("ParallelReader", error_);
+
+  queued_ -= bytes_[consumed_];
+  entries.swap(slices_[consumed_++]);
+  changed_.notify_all();
+  return true;
+}
+
+void ParallelReader::stop()
+{
+  {
+    boost::mutex::scoped_lock lock(mutex_);
+    stop_ = true;
+    changed_.notify_all();
+  }
+  workers_.join_all();
+}
+
+void ParallelReader::run()
+{
+  try {
+    // every worker opens its own bag instances once
+    std::map<std::string, boost::shared_ptr< ::rosbag::Bag> > bags;
+    for(std::vector<std::pair<std::string, ::rosbag::Query> >::const_iterator it = queries_.begin(); it != queries_.end(); ++it) {
+      boost::shared_ptr< ::rosbag::Bag> &bag = bags[it->first];
+      if (!bag) bag.reset(new ::rosbag::Bag(it->first, ::rosbag::bagmode::Read));
+    }
+
+    while(true) {
+      std::size_t slice;
+      {
+        // the slice the caller waits for is always claimed, later ones only while the queue is not full
+        boost::mutex::scoped_lock lock(mutex_);
+        while(!stop_ && claimed_ < slices_.size() && claimed_ > consumed_ && queued_ >= queue_bytes_) changed_.wait(lock);
+        if (stop_ || claimed_ >= slices_.size()) return;
+        slice = claimed_++;
+      }
+
+      Entries entries;
+      std::size_t bytes = work(bags, slice, entries);
+
+      boost::mutex::scoped_lock lock(mutex_);
+      slices_[slice].swap(entries);
+      done_[slice] = true;
+      bytes_[slice] = bytes;
+      queued_ += bytes;
+      changed_.notify_all();
+    }
+
+  } catch(std::exception &e) {
+    boost::mutex::scoped_lock lock(mutex_);
+    if (error_.empty()) error_ = e.what();
+    stop_ = true;
+    changed_.notify_all();
+  }
+}
+
+std::size_t ParallelReader::work(const std::map<std::string, boost::shared_ptr< ::rosbag::Bag> >& bags, std::size_t slice, Entries &entries)
+{
+  const ros::Time &start = ranges_[slice].first, &end = ranges_[slice].second;
+  ::rosbag::View view;
+  std::size_t bytes = 0;
+
+  for(std::vector<std::pair<std::string, ::rosbag::Query> >::const_iterator it = queries_.begin(); it != queries_.end(); ++it) {
+    const ::rosbag::Query &query = it->second;
+    ros::Time query_start = std::max(start, query.getStartTime());
+    ros::Time query_end   = std::min(end, query.getEndTime());
+    if (query_end < query_start) continue;
+    view.addQuery(*bags.find(it->first)->second, boost::bind(&ParallelReader::accept, this, query.getQuery(), _1), query_start, query_end);
+  }
+
+  entries.reserve(view.size());
+  for(::rosbag::View::iterator it = view.begin(); it != view.end(); ++it) {
+    Entry entry;
+    entry.topic = it->getTopic();
+    entry.time = it->getTime();
+
+    std::map<std::string, cpp_introspection::MessagePtr>::const_iterator type = types_.find(it->getMD5Sum());
+    if (type != types_.end() && type->second) {
+      boost::shared_ptr<MessageSpan> span = it->instantiate<MessageSpan>();
+      ros::serialization::IStream stream(span->data, span->size);
+      entry.introspection = type->second;
+      entry.instance = type->second->deserialize(stream);
+      bytes += span->size;
+    } else {
+      std::map<std::string, DynamicDecoderPtr>::const_iterator decoder = decoders_.find(it->getMD5Sum());
+      if (decoder != decoders_.end() && decoder->second) {
+        boost::shared_ptr<MessageSpan> span = it->instantiate<MessageSpan>();
+        entry.decoder = decoder->second;
+        entry.buffer.assign(span->data, span->data + span->size);
+        bytes += span->size;
+      }
+    }
+
+    entries.push_back(entry);
+  }
+  return bytes;
+}
+
+} // namespace rosbag
+} // namespace rosmatlab
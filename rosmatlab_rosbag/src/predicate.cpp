@@ -0,0 +1,255 @@
+//=================================================================================================
+// Copyright (c) 2013, Johannes Meyer, TU Darmstadt
+// All rights reserved.
+
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//     * Redistributions of source code must retain the above copyright
+//       notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above copyright
+//       notice, this list of conditions and the following disclaimer in the
+//       documentation and/or other materials provided with the distribution.
+//     * Neither the name of the Flight Systems and Automatic Control group,
+//       TU Darmstadt, nor the names of its contributors may be used to
+//       endorse or promote products derived from this software without
+//       specific prior written permission.
+
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+// ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+// WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER BE LIABLE FOR ANY
+// DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+// (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+// LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+// ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+// SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+//=================================================================================================
+
+
+#include <rosmatlab/rosbag/predicate.h>
+#include <rosmatlab/rosbag/field_path.h>
+#include <rosmatlab/exception.h>
+
+#include <introspection/message.h>
+#include <introspection/type.h>
+
+#include <boost/lexical_cast.hpp>
+
+#include <algorithm>
+#include <cctype>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
+namespace rosmatlab {
+namespace rosbag {
+
+using namespace cpp_introspection;
+
+class Predicate::Node {
+public:
+  virtual ~Node() {}
+  virtual bool evaluate(const MessagePtr& message) const = 0;
+};
+
+namespace {
+  class And : public Predicate::Node {
+  public:
+    And(const Predicate::NodePtr& a, const Predicate::NodePtr& b) : a_(a), b_(b) {}
+    bool evaluate(const MessagePtr& message) const { return a_->evaluate(message) && b_->evaluate(message); }
+  private:
+    Predicate::NodePtr a_, b_;
+  };
+
+  class Or : public Predicate::Node {
+  public:
+    Or(const Predicate::NodePtr& a, const Predicate::NodePtr& b) : a_(a), b_(b) {}
+    bool evaluate(const MessagePtr& message) const { return a_->evaluate(message) || b_->evaluate(message); }
+  private:
+    Predicate::NodePtr a_, b_;
+  };
+
+  class Not : public Predicate::Node {
+  public:
+    Not(const Predicate::NodePtr& a) : a_(a) {}
+    bool evaluate(const MessagePtr& message) const { return !a_->evaluate(message); }
+  private:
+    Predicate::NodePtr a_;
+  };
+
+  enum Operator { EQUAL, NOT_EQUAL, LESS, LESS_EQUAL, GREATER, GREATER_EQUAL };
+
+  class Comparison : public Predicate::Node {
+  public:
+    Comparison(const FieldPath& path, Operator op, double number)
+      : path_(path), op_(op), is_string_(false), number_(number) {}
+    Comparison(const FieldPath& path, Operator op, const std::string& string)
+      : path_(path), op_(op), is_string_(true), number_(0.0), string_(string) {}
+
+    bool evaluate(const MessagePtr& message) const { return visit(message, 0); }
+
+  private:
+    template <typename T> bool compare(const T& a, const T& b) const {
+      switch(op_) {
+        case EQUAL:         return a == b;
+        case NOT_EQUAL:     return a != b;
+        case LESS:          return a < b;
+        case LESS_EQUAL:    return a <= b;
+        case GREATER:       return a > b;
+        case GREATER_EQUAL: return a >= b;
+      }
+      return false;
+    }
+
+    bool visit(const MessagePtr& message, std::size_t step) const {
+      FieldPtr f = path_.resolve(message, step);
+      std::size_t begin = 0, end = f->size();
+      if (path_[step].index >= 0) {
+        begin = path_[step].index;
+        end = std::min<std::size_t>(end, begin + 1);
+      }
+
+      for(std::size_t i = begin; i < end; ++i) {
+        if (step + 1 < path_.size()) {
+          if (!f->isMessage()) throw Exception("Query", "field " + path_[step].name + " is not a message");
+          MessagePtr child = f->expand(i);
+          if (child && visit(child, step + 1)) return true;
+          continue;
+        }
+
+        if (f->isMessage()) throw Exception("Query", "cannot compare message field " + path_[step].name);
+        TypePtr type = f->getType();
+        if (is_string_) {
+          if (!type->isString()) throw Exception("Query", "field " + path_[step].name + " is not a string");
+          if (compare(type->as_string(f->get(i)), string_)) return true;
+        } else {
+          if (type->isString()) throw Exception("Query", "field " + path_[step].name + " is a string");
+          if (compare(type->as_double(f->get(i)), number_)) return true;
+        }
+      }
+      return false;
+    }
+
+    FieldPath path_;
+    Operator op_;
+    bool is_string_;
+    double number_;
+    std::string string_;
+  };
+
+  // recursive descent parser
+  class Parser {
+  public:
+    Parser(const std::string& expression) : expression_(expression), pos_(0) {}
+
+    Predicate::NodePtr parse() {
+      Predicate::NodePtr result = parseOr();
+      skipSpace();
+      if (pos_ != expression_.size()) error("unexpected input");
+      return result;
+    }
+
+  private:
+    void error(const std::string& message) const {
+      throw Exception("Query", message + " at position " + boost::lexical_cast<std::string>(pos_ + 1) + " of '" + expression_ + "'");
+    }
+
+    void skipSpace() {
+      while(pos_ < expression_.size() && std::isspace(expression_[pos_])) pos_++;
+    }
+
+    bool accept(const char *token) {
+      skipSpace();
+      std::size_t length = std::strlen(token);
+      if (expression_.compare(pos_, length, token) != 0) return false;
+      // keywords must not be followed by identifier characters
+      if (std::isalpha(token[0]) && pos_ + length < expression_.size() && (std::isalnum(expression_[pos_ + length]) || expression_[pos_ + length] == '_')) return false;
+      pos_ += length;
+      return true;
+    }
+
+    Predicate::NodePtr parseOr() {
+      Predicate::NodePtr result = parseAnd();
+      while(accept("||") || accept("or")) result.reset(new Or(result, parseAnd()));
+      return result;
+    }
+
+    Predicate::NodePtr parseAnd() {
+      Predicate::NodePtr result = parseUnary();
+      while(accept("&&") || accept("and")) result.reset(new And(result, parseUnary()));
+      return result;
+    }
+
+    Predicate::NodePtr parseUnary() {
+      if (accept("!=")) error("unexpected operator");
+      if (accept("!") || accept("not")) return Predicate::NodePtr(new Not(parseUnary()));
+      if (accept("(")) {
+        Predicate::NodePtr result = parseOr();
+        if (!accept(")")) error("expected ')'");
+        return result;
+      }
+      return parseComparison();
+    }
+
+    Predicate::NodePtr parseComparison() {
+      FieldPath path = parsePath();
+
+      Operator op;
+      if      (accept("==")) op = EQUAL;
+      else if (accept("!=")) op = NOT_EQUAL;
+      else if (accept("<=")) op = LESS_EQUAL;
+      else if (accept(">=")) op = GREATER_EQUAL;
+      else if (accept("<"))  op = LESS;
+      else if (accept(">"))  op = GREATER;
+      else if (accept("="))  op = EQUAL;
+      else { error("expected comparison operator"); return Predicate::NodePtr(); }
+
+      skipSpace();
+      if (pos_ < expression_.size() && (expression_[pos_] == '\'' || expression_[pos_] == '"')) {
+        char quote = expression_[pos_++];
+        std::size_t end = expression_.find(quote, pos_);
+        if (end == std::string::npos) error("unterminated string");
+        std::string value = expression_.substr(pos_, end - pos_);
+        pos_ = end + 1;
+        return Predicate::NodePtr(new Comparison(path, op, value));
+      }
+
+      if (accept("true"))  return Predicate::NodePtr(new Comparison(path, op, 1.0));
+      if (accept("false")) return Predicate::NodePtr(new Comparison(path, op, 0.0));
+
+      const char *begin = expression_.c_str() + pos_;
+      char *end = 0;
+      double value = std::strtod(begin, &end);
+      if (end == begin) error("expected number, string or boolean");
+      pos_ += end - begin;
+      return Predicate::NodePtr(new Comparison(path, op, value));
+    }
+
+    FieldPath parsePath() {
+      skipSpace();
+      return FieldPath::parse(expression_, pos_);
+    }
+
+    const std::string& expression_;
+    std::size_t pos_;
+  };
+}
+
+Predicate::Predicate(const std::string& expression)
+  : expression_(expression)
+{
+  root_ = Parser(expression_).parse();
+}
+
+Predicate::~Predicate()
+{
+}
+
+bool Predicate::operator()(const MessagePtr& message) const
+{
+  return root_->evaluate(message);
+}
+
+} // namespace rosbag
+} // namespace rosmatlab
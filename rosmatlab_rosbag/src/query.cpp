@@ -29,6 +29,7 @@
 #include <rosmatlab/rosbag/query.h>
 
 #include <rosmatlab/options.h>
+#include <rosmatlab/exception.h>
 #include <rosmatlab/connection_header.h>
 #include <rosmatlab/conversion.h>
 #include <rosmatlab/log.h>
@@ -39,11 +40,55 @@
 #include <introspection/message.h>
 
 #include <boost/algorithm/string/replace.hpp>
+#include <boost/lexical_cast.hpp>
 
 
 namespace rosmatlab {
 namespace rosbag {
 
+Decimator::Decimator(unsigned int step, double rate, std::size_t max_count)
+  : step_(step > 0 ? step : 1)
+  , rate_(rate)
+  , max_count_(max_count)
+{
+  reset();
+}
+
+Decimator Decimator::fromOptions(const Options& options)
+{
+  if (!options.hasKey("step") && !options.hasKey("rate") && !options.hasKey("maxcount")) return Decimator();
+
+  int step = options.getInteger("step", 1);
+  double rate = options.getDouble("rate");
+  int max_count = options.getInteger("maxcount");
+  if (step < 1) throw Exception("Query", "step must be a positive integer");
+  if (rate < 0 || max_count < 0) throw Exception("Query", "rate and maxCount must not be negative");
+  return Decimator(step, rate, max_count);
+}
+
+bool Decimator::operator()(const ros::Time& time)
+{
+  if (seen_++ % step_ != 0) return false;
+  if (max_count_ > 0 && kept_ >= max_count_) return false;
+  if (rate_ > 0.0 && kept_ > 0 && (time - last_).toSec() < 1.0 / rate_) return false;
+
+  kept_++;
+  last_ = time;
+  return true;
+}
+
+void Decimator::reset()
+{
+  seen_ = 0;
+  kept_ = 0;
+  last_ = ros::Time();
+}
+
+std::string Decimator::toString() const
+{
+  return "step=" + boost::lexical_cast<std::string>(step_) + ",rate=" + boost::lexical_cast<std::string>(rate_) + ",maxcount=" + boost::lexical_cast<std::string>(max_count_);
+}
+
 Query::Query()
   : start_time_(ros::TIME_MIN)
   , end_time_(ros::TIME_MAX)
@@ -83,6 +128,9 @@ void Query::init(const Options &options)
   if (options.hasKey("datatype")) datatypes_.insert(options.getStrings("datatype").begin(), options.getStrings("datatype").end());
   if (options.hasKey("md5sum"))   md5sums_.insert(options.getStrings("md5sum").begin(), options.getStrings("md5sum").end());
 
+  decimator_ = Decimator::fromOptions(options);
+  if (options.hasKey("where"))    predicate_.reset(new Predicate(options.getString("where")));
+
   // default option are topics
   if (options.hasKey(""))         topics_.insert(options.getStrings("").begin(), options.getStrings("").end());
 
@@ -99,6 +147,8 @@ bool Query::operator()(const ConnectionInfo *info)
 
 ros::Time const& Query::getStartTime() const { return start_time_; }
 ros::Time const& Query::getEndTime()   const { return end_time_;   }
+Decimator const& Query::getDecimator() const { return decimator_; }
+PredicatePtr const& Query::getPredicate() const { return predicate_; }
 
 mxArray *Query::toMatlab(const std::vector<boost::shared_ptr<Query> > &queries) {
   mxArray *result;
@@ -0,0 +1,249 @@
+//=================================================================================================
+// Copyright (c) 2013, Johannes Meyer, TU Darmstadt
+// All rights reserved.
+
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//     * Redistributions of source code must retain the above copyright
+//       notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above copyright
+//       notice, this list of conditions and the following disclaimer in the
+//       documentation and/or other materials provided with the distribution.
+//     * Neither the name of the Flight Systems and Automatic Control group,
+//       TU Darmstadt, nor the names of its contributors may be used to
+//       endorse or promote products derived from this software without
+//       specific prior written permission.
+
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+// ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+// WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER BE LIABLE FOR ANY
+// DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+// (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+// LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+// ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+// SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+//=================================================================================================
+
+
+#include <rosmatlab/rosbag/reindexer.h>
+#include <rosmatlab/rosbag/message_span.h>
+#include <rosmatlab/rosbag/cache.h>
+#include <rosmatlab/exception.h>
+
+#include <ros/common.h>
+#include <bzlib.h>
+#if ROS_VERSION_MINIMUM(1,11,0)
+  #include <roslz4/lz4s.h>
+#endif
+
+#include <sys/stat.h>
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+
+namespace rosmatlab {
+namespace rosbag {
+
+namespace {
+  // record opcodes of bag format version 2.0
+  const char OP_MSG_DATA    = 0x02;
+  const char OP_CHUNK       = 0x05;
+  const char OP_CONNECTION  = 0x07;
+
+  uint32_t readUInt32(const uint8_t *p)
+  {
+    uint32_t value;
+    std::memcpy(&value, p, sizeof(value));
+    return value;
+  }
+
+  // read a record from a buffer, false if it is truncated
+  bool readRecord(const uint8_t *&pos, const uint8_t *end, const uint8_t *&header, uint32_t &header_length, const uint8_t *&data, uint32_t &data_length)
+  {
+    if (end - pos < 4) return false;
+    header_length = readUInt32(pos);
+    if (static_cast<uint64_t>(end - pos - 4) < header_length + 4ull) return false;
+    header = pos + 4;
+    data_length = readUInt32(header + header_length);
+    data = header + header_length + 4;
+    if (static_cast<uint64_t>(end - data) < data_length) return false;
+    pos = data + data_length;
+    return true;
+  }
+
+  // parse a connection header (sequence of <uint32 length><name>=<value>)
+  void parseFields(const uint8_t *data, uint32_t length, ros::M_string& fields)
+  {
+    const uint8_t *end = data + length;
+    while(end - data >= 4) {
+      uint32_t field_length = readUInt32(data);
+      data += 4;
+      if (field_length > static_cast<uint32_t>(end - data)) break;
+      const uint8_t *separator = static_cast<const uint8_t *>(std::memchr(data, '=', field_length));
+      if (separator) fields[std::string(reinterpret_cast<const char *>(data), separator - data)] = std::string(reinterpret_cast<const char *>(separator + 1), data + field_length - separator - 1);
+      data += field_length;
+    }
+  }
+
+  bool decompress(const std::string& compression, const uint8_t *source, uint32_t source_size, uint8_t *target, uint32_t target_size)
+  {
+    unsigned int length = target_size;
+    if (compression == "bz2") {
+      return BZ2_bzBuffToBuffDecompress(reinterpret_cast<char *>(target), &length, const_cast<char *>(reinterpret_cast<const char *>(source)), source_size, 0, 0) == BZ_OK && length == target_size;
+    }
+#if ROS_VERSION_MINIMUM(1,11,0)
+    if (compression == "lz4") {
+      return roslz4_buffToBuffDecompress(const_cast<char *>(reinterpret_cast<const char *>(source)), source_size, reinterpret_cast<char *>(target), &length) == ROSLZ4_OK && length == target_size;
+    }
+#endif
+    return false;
+  }
+
+  ::rosbag::compression::CompressionType compressionType(const std::string& compression)
+  {
+    if (compression == "bz2") return ::rosbag::compression::BZ2;
+#if ROS_VERSION_MINIMUM(1,11,0)
+    if (compression == "lz4") return ::rosbag::compression::LZ4;
+#endif
+    return ::rosbag::compression::Uncompressed;
+  }
+}
+
+Reindexer::Reindexer(const std::string& filename)
+  : filename_(filename)
+  , file_(filename)
+  , count_(0)
+{
+}
+
+Reindexer::~Reindexer()
+{
+}
+
+std::size_t Reindexer::write(const std::string& target)
+{
+  static const char magic[] = "#ROSBAG V2.0\n";
+  if (file_.size() < sizeof(magic) - 1 || std::memcmp(file_.data(), magic, sizeof(magic) - 1) != 0) throw Exception("Reindexer", filename_ + " is not a bag of format version 2.0");
+
+  ::rosbag::Bag bag(target, ::rosbag::bagmode::Write);
+  file_.advise(MappedFile::SEQUENTIAL);
+  connections_.clear();
+  count_ = 0;
+
+  std::vector<uint8_t> buffer;
+  bool compression_set = false;
+  const uint8_t *pos = file_.data() + sizeof(magic) - 1, *end = file_.data() + file_.size();
+  const uint8_t *header, *data;
+  uint32_t header_length, data_length;
+  while(readRecord(pos, end, header, header_length, data, data_length)) {
+    std::string op;
+    if (!MappedFile::findField(header, header_length, "op", op) || op.size() != 1) break;
+
+    // records outside of chunks are the index (ignored) or the unfinished chunk of an uncompressed bag
+    if (op[0] != OP_CHUNK) {
+      record(header, header_length, data, data_length, bag);
+      continue;
+    }
+
+    std::string compression, size;
+    if (!MappedFile::findField(header, header_length, "compression", compression) || !MappedFile::findField(header, header_length, "size", size) || size.size() != 4) break;
+    if (!compression_set) {
+      bag.setCompression(compressionType(compression));
+      compression_set = true;
+    }
+
+    if (compression == "none") {
+      chunk(data, data_length, bag);
+      continue;
+    }
+
+    buffer.resize(readUInt32(reinterpret_cast<const uint8_t *>(size.data())));
+    if (!decompress(compression, data, data_length, buffer.data(), buffer.size())) break;
+    chunk(buffer.data(), buffer.size(), bag);
+  }
+
+  bag.close();
+  return count_;
+}
+
+void Reindexer::chunk(const uint8_t *data, uint32_t size, ::rosbag::Bag& bag)
+{
+  const uint8_t *pos = data, *end = data + size;
+  const uint8_t *header, *record_data;
+  uint32_t header_length, data_length;
+  while(readRecord(pos, end, header, header_length, record_data, data_length)) {
+    record(header, header_length, record_data, data_length, bag);
+  }
+}
+
+void Reindexer::record(const uint8_t *header, uint32_t header_length, const uint8_t *data, uint32_t data_length, ::rosbag::Bag& bag)
+{
+  std::string op, conn;
+  if (!MappedFile::findField(header, header_length, "op", op) || op.size() != 1) return;
+  if (op[0] != OP_CONNECTION && op[0] != OP_MSG_DATA) return;
+  if (!MappedFile::findField(header, header_length, "conn", conn) || conn.size() != 4) return;
+  uint32_t id = readUInt32(reinterpret_cast<const uint8_t *>(conn.data()));
+
+  if (op[0] == OP_CONNECTION) {
+    if (connections_.count(id)) return;
+    Connection &connection = connections_[id];
+    MappedFile::findField(header, header_length, "topic", connection.topic);
+    connection.header.reset(new ros::M_string);
+    parseFields(data, data_length, *connection.header);
+    connection.datatype = (*connection.header)["type"];
+    connection.md5sum = (*connection.header)["md5sum"];
+    connection.definition = (*connection.header)["message_definition"];
+    return;
+  }
+
+  std::string time;
+  std::map<uint32_t, Connection>::const_iterator connection = connections_.find(id);
+  if (connection == connections_.end() || !MappedFile::findField(header, header_length, "time", time) || time.size() != 8) return;
+
+  // rosbag refuses to write messages before ros::TIME_MIN (e.g. recorded with time 0), which are clamped to it
+  ros::Time stamp(readUInt32(reinterpret_cast<const uint8_t *>(time.data())), readUInt32(reinterpret_cast<const uint8_t *>(time.data()) + 4));
+  if (stamp < ros::TIME_MIN) stamp = ros::TIME_MIN;
+
+  const Connection &c = connection->second;
+  MessageSpan span(const_cast<uint8_t *>(data), data_length, c.datatype.c_str(), c.md5sum.c_str(), c.definition.c_str());
+  bag.write(c.topic, stamp, span, c.header);
+  count_++;
+}
+
+std::string Reindexer::sidecar(const std::string& filename)
+{
+  // the copy is only valid for the size and modification time of the original recorded in its key file
+  Cache cache(filename);
+  std::string target = cache.directory() + "/reindexed.bag";
+  std::string key_file = cache.directory() + "/reindexed.key";
+  std::string key = cache.key("reindexed");
+  {
+    std::ifstream stream(key_file.c_str());
+    std::string existing;
+    if (stream && std::getline(stream, existing) && existing == key) return target;
+  }
+
+  if (::mkdir(cache.directory().c_str(), 0755) < 0 && errno != EEXIST) throw Exception("Reindexer", "could not create " + cache.directory() + ": " + std::strerror(errno));
+  std::string temporary = target + ".tmp";
+  try {
+    Reindexer(filename).write(temporary);
+  } catch(...) {
+    std::remove(temporary.c_str());
+    throw;
+  }
+  if (std::rename(temporary.c_str(), target.c_str()) < 0) {
+    std::remove(temporary.c_str());
+    throw Exception("Reindexer", "could not write " + target + ": " + std::strerror(errno));
+  }
+
+  std::ofstream stream(key_file.c_str(), std::ios::out | std::ios::trunc);
+  stream << key << std::endl;
+  if (!stream) throw Exception("Reindexer", "could not write " + key_file);
+  return target;
+}
+
+} // namespace rosbag
+} // namespace rosmatlab
@@ -0,0 +1,103 @@
+//=================================================================================================
+// Copyright (c) 2013, Johannes Meyer, TU Darmstadt
+// All rights reserved.
+
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//     * Redistributions of source code must retain the above copyright
+//       notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above copyright
+//       notice, this list of conditions and the following disclaimer in the
+//       documentation and/or other materials provided with the distribution.
+//     * Neither the name of the Flight Systems and Automatic Control group,
+//       TU Darmstadt, nor the names of its contributors may be used to
+//       endorse or promote products derived from this software without
+//       specific prior written permission.
+
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+// ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+// WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER BE LIABLE FOR ANY
+// DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+// (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+// LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+// ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+// SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+//=================================================================================================
+
+
+#include <rosmatlab/rosbag/resampler.h>
+
+#include <algorithm>
+#include <limits>
+
+namespace rosmatlab {
+namespace rosbag {
+
+Resampler::Resampler(const std::vector<double>& grid, std::size_t columns, Method method, double *output)
+  : grid_(grid)
+  , method_(method)
+  , output_(output)
+{
+  std::fill(output_, output_ + grid_.size() * columns, std::numeric_limits<double>::quiet_NaN());
+}
+
+Resampler::~Resampler()
+{
+}
+
+std::size_t Resampler::addSignal(const std::vector<std::size_t>& columns)
+{
+  Signal signal;
+  signal.columns = columns;
+  signal.cursor = 0;
+  signal.valid = false;
+  signal.time = 0.0;
+  signals_.push_back(signal);
+  return signals_.size() - 1;
+}
+
+void Resampler::add(std::size_t index, double time, const std::vector<double>& values)
+{
+  Signal &signal = signals_[index];
+
+  // fill all grid points before this sample from the previous one
+  for(; signal.cursor < grid_.size() && grid_[signal.cursor] < time; ++signal.cursor) {
+    if (!signal.valid) continue;
+    double t = grid_[signal.cursor];
+    for(std::size_t i = 0; i < signal.columns.size(); ++i) {
+      double value = signal.values[i];
+      if (method_ == LINEAR && time > signal.time) value += (values[i] - signal.values[i]) * (t - signal.time) / (time - signal.time);
+      set(signal.cursor, signal.columns[i], value);
+    }
+  }
+
+  signal.valid = true;
+  signal.time = time;
+  signal.values = values;
+}
+
+void Resampler::finish()
+{
+  // remaining grid points are at or after the last sample
+  for(std::vector<Signal>::iterator signal = signals_.begin(); signal != signals_.end(); ++signal) {
+    if (!signal->valid) continue;
+    for(; signal->cursor < grid_.size(); ++signal->cursor) {
+      if (method_ == LINEAR && grid_[signal->cursor] != signal->time) break;
+      for(std::size_t i = 0; i < signal->columns.size(); ++i) set(signal->cursor, signal->columns[i], signal->values[i]);
+    }
+  }
+}
+
+bool Resampler::done() const
+{
+  if (grid_.empty()) return true;
+  for(std::vector<Signal>::const_iterator signal = signals_.begin(); signal != signals_.end(); ++signal) {
+    if (!signal->valid || signal->time < grid_.back()) return false;
+  }
+  return true;
+}
+
+} // namespace rosbag
+} // namespace rosmatlab
@@ -29,6 +29,14 @@
 #include <rosmatlab/rosbag/view.h>
 #include <rosmatlab/rosbag/bag.h>
 #include <rosmatlab/rosbag/query.h>
+#include <rosmatlab/rosbag/message_span.h>
+#include <rosmatlab/rosbag/parallel_reader.h>
+#include <rosmatlab/rosbag/merged_reader.h>
+#include <rosmatlab/rosbag/mapped_file.h>
+#include <rosmatlab/rosbag/cache.h>
+#include <rosmatlab/rosbag/field_path.h>
+#include <rosmatlab/rosbag/resampler.h>
+#include <rosmatlab/rosbag/dynamic_decoder.h>
 
 #include <rosmatlab/options.h>
 #include <rosmatlab/connection_header.h>
@@ -36,9 +44,18 @@
 #include <rosmatlab/log.h>
 
 #include <ros/forwards.h>
+#include <mat.h>
 #include <introspection/message.h>
 
 #include <boost/algorithm/string/replace.hpp>
+#include <boost/lexical_cast.hpp>
+
+#include <algorithm>
+#include <functional>
+#include <limits>
+#include <queue>
+#include <set>
+#include <sstream>
 
 
 namespace rosmatlab {
@@ -48,18 +65,51 @@ template <> const char *Object<View>::class_name_ = "rosbag.View";
 
 View::View(int nrhs, const mxArray *prhs[])
   : Object<View>(this)
+  , seek_revision_(0)
+  , writer_(0)
 {
   reset();
+
+  // rosbag.View(view, begin, end) creates a window of an existing view
+  if (nrhs > 0 && mxIsClass(prhs[0], getClassName())) {
+    View *source = getObject<View>(prhs[0]);
+    if (!source) throw Exception("View", "first argument is not a valid view handle");
+    ros::Time begin = (nrhs > 1 && !mxIsEmpty(prhs[1])) ? ros::Time(Options::getDoubleScalar(prhs[1])) : ros::TIME_MIN;
+    ros::Time end   = (nrhs > 2 && !mxIsEmpty(prhs[2])) ? ros::Time(Options::getDoubleScalar(prhs[2])) : ros::TIME_MAX;
+    addWindow(*source, begin, end);
+    return;
+  }
+
   if (nrhs > 0) addQuery(nrhs, prhs);
 }
 
 View::View(const Bag& bag, int nrhs, const mxArray *prhs[])
   : Object<View>(this)
+  , seek_revision_(0)
+  , writer_(0)
 {
   reset();
   addQuery(bag, nrhs, prhs);
 }
 
+View::View(const Bag& bag, const Options& options)
+  : Object<View>(this)
+  , seek_revision_(0)
+  , writer_(0)
+{
+  reset();
+  addQuery(bag, options);
+}
+
+View::View(View& source, const ros::Time& begin, const ros::Time& end)
+  : Object<View>(this)
+  , seek_revision_(0)
+  , writer_(0)
+{
+  reset();
+  addWindow(source, begin, end);
+}
+
 View::~View()
 {
 }
@@ -81,7 +131,13 @@ void View::addQuery(int nrhs, const mxArray *prhs[])
 
 void View::addQuery(const Bag& bag, int nrhs, const mxArray *prhs[])
 {
-  QueryPtr query(new Query(nrhs, prhs));
+  addQuery(bag, Options(nrhs, prhs, true));
+}
+
+void View::addQuery(const Bag& bag, const Options& options)
+{
+  bag.flush();
+  QueryPtr query(new Query(options));
   ::rosbag::View::addQuery(bag, *query, query->getStartTime(), query->getEndTime());
   queries_.push_back(query);
 }
@@ -90,15 +146,247 @@ void View::reset()
 {
   current_ = end();
   eof_ = false;
+  pending_ = false;
+  bound_ = end();
+  seek_view_.reset();
 }
 
 bool View::start()
 {
   current_ = begin();
   eof_ = false;
+  pending_ = false;
+  seek_view_.reset();
+  resetFilters();
+  skipRejected();
   return valid();
 }
 
+void View::resetFilters()
+{
+  // one decimator and one predicate per topic, configured by the first query that matches the topic
+  decimators_.clear();
+  predicates_.clear();
+  update();
+  std::set<std::string> configured;
+  for(std::vector< ::rosbag::MessageRange* >::const_iterator range = ranges_.begin(); range != ranges_.end(); ++range) {
+    const std::string &topic = (*range)->connection_info->topic;
+    if (!configured.insert(topic).second) continue;
+
+    std::size_t i = std::find(::rosbag::View::queries_.begin(), ::rosbag::View::queries_.end(), (*range)->bag_query) - ::rosbag::View::queries_.begin();
+    QueryPtr query = (i < queries_.size()) ? queries_[i] : QueryPtr();
+
+    Decimator decimator = decimation_;
+    if (!decimator.active() && query) decimator = query->getDecimator();
+    if (decimator.active()) {
+      decimator.reset();
+      decimators_[topic] = decimator;
+    }
+
+    if (query && query->getPredicate()) predicates_[topic] = query->getPredicate();
+  }
+}
+
+bool View::accept()
+{
+  std::map<std::string, Decimator>::iterator decimator = decimators_.find(current_->getTopic());
+  if (decimator != decimators_.end() && !decimator->second(current_->getTime())) return false;
+
+  // predicates need the deserialized message, which is kept for getInternal()
+  std::map<std::string, PredicatePtr>::const_iterator predicate = predicates_.find(current_->getTopic());
+  if (predicate == predicates_.end()) return true;
+  if (!introspect(current_->getMD5Sum())) return false;
+  message_instance_ = deserialize(*current_->instantiate<MessageSpan>());
+  return message_instance_ && (*predicate->second)(message_instance_);
+}
+
+void View::skipRejected()
+{
+  // messages rejected by a decimator are skipped on the index only and never read,
+  // the message at bound_ is left unevaluated
+  while((!decimators_.empty() || !predicates_.empty()) && valid() && current_ != bound_ && !accept()) {
+    message_instance_.reset();
+    current_++;
+  }
+}
+
+namespace {
+  typedef std::multiset< ::rosbag::IndexEntry>::const_iterator IndexIterator;
+
+  struct IndexTimeCompare {
+    bool operator()(const IndexIterator& a, const ros::Time& b) const { return a->time < b; }
+    bool operator()(const ros::Time& a, const IndexIterator& b) const { return a < b->time; }
+  };
+
+  // iteration state of one range while merging, ordered for a min-heap on time
+  struct MergeCursor {
+    ros::Time time;
+    std::size_t range;
+    std::size_t index;
+    bool operator<(const MergeCursor& other) const { return time > other.time || (time == other.time && range > other.range); }
+  };
+
+  // a view that iterates over message ranges set up by its owner
+  class SeekView : public ::rosbag::View {
+  public:
+    void add(const ::rosbag::MessageRange *range, const IndexIterator& begin) {
+      ranges_.push_back(new ::rosbag::MessageRange(begin, range->end, range->connection_info, range->bag_query));
+    }
+    void finalize() { view_revision_++; }
+  };
+}
+
+const std::vector<View::SeekRange>& View::seekRanges()
+{
+  // the index is rebuilt after the ranges of this view have changed
+  update();
+  if (!seek_index_.empty() && seek_revision_ == view_revision_) return seek_index_;
+
+  seek_index_.clear();
+  seek_index_.resize(ranges_.size());
+  std::priority_queue<MergeCursor> queue;
+  for(std::size_t i = 0; i < ranges_.size(); ++i) {
+    SeekRange &seek_range = seek_index_[i];
+    seek_range.range = ranges_[i];
+    for(IndexIterator entry = ranges_[i]->begin; entry != ranges_[i]->end; ++entry) seek_range.entries.push_back(entry);
+    seek_range.positions.resize(seek_range.entries.size());
+    if (!seek_range.entries.empty()) {
+      MergeCursor cursor = { seek_range.entries.front()->time, i, 0 };
+      queue.push(cursor);
+    }
+  }
+
+  // number all messages in time order
+  for(uint32_t position = 0; !queue.empty(); ++position) {
+    MergeCursor cursor = queue.top();
+    queue.pop();
+    SeekRange &seek_range = seek_index_[cursor.range];
+    seek_range.positions[cursor.index] = position;
+    if (++cursor.index < seek_range.entries.size()) {
+      cursor.time = seek_range.entries[cursor.index]->time;
+      queue.push(cursor);
+    }
+  }
+
+  seek_revision_ = view_revision_;
+  return seek_index_;
+}
+
+bool View::seekTo(const std::vector<std::size_t>& starts)
+{
+  const std::vector<SeekRange>& index = seekRanges();
+  boost::shared_ptr<SeekView> view(new SeekView());
+  for(std::size_t i = 0; i < index.size(); ++i) {
+    view->add(index[i].range, starts[i] < index[i].entries.size() ? index[i].entries[starts[i]] : index[i].range->end);
+  }
+  view->finalize();
+
+  message_instance_.reset();
+  current_ = view->begin();
+  pending_ = false;
+  seek_view_ = view;
+  resetFilters();
+  skipRejected();
+  eof_ = !valid();
+  return valid();
+}
+
+bool View::seek(int nrhs, const mxArray *prhs[])
+{
+  if (nrhs < 1) throw ArgumentException("View.seek", 1);
+  return seek(ros::Time(Options::getDoubleScalar(prhs[0])));
+}
+
+bool View::seek(const ros::Time& time)
+{
+  // first message at or after time in every range
+  const std::vector<SeekRange>& index = seekRanges();
+  std::vector<std::size_t> starts(index.size());
+  for(std::size_t i = 0; i < index.size(); ++i) {
+    starts[i] = std::lower_bound(index[i].entries.begin(), index[i].entries.end(), time, IndexTimeCompare()) - index[i].entries.begin();
+  }
+  return seekTo(starts);
+}
+
+bool View::seekIndex(int nrhs, const mxArray *prhs[])
+{
+  if (nrhs < 1) throw ArgumentException("View.seekIndex", 1);
+  double index = Options::getDoubleScalar(prhs[0]);
+  if (index < 1) throw Exception("View.seekIndex", "index must be a positive integer");
+  return seekIndex(static_cast<std::size_t>(index) - 1);
+}
+
+bool View::seekIndex(std::size_t position)
+{
+  // first message at or after the zero-based position in every range
+  const std::vector<SeekRange>& index = seekRanges();
+  std::vector<std::size_t> starts(index.size());
+  for(std::size_t i = 0; i < index.size(); ++i) {
+    starts[i] = std::lower_bound(index[i].positions.begin(), index[i].positions.end(), position) - index[i].positions.begin();
+  }
+  return seekTo(starts);
+}
+
+namespace {
+  struct RangeCursor {
+    IndexIterator entry;
+    IndexIterator end;
+    bool operator<(const RangeCursor& other) const { return entry->time > other.entry->time; }
+  };
+}
+
+std::size_t View::countDecimated(const std::string& topic)
+{
+  std::map<std::string, Decimator>::const_iterator found = decimators_.find(topic);
+  std::priority_queue<RangeCursor> queue;
+  std::size_t count = 0;
+  for(std::vector< ::rosbag::MessageRange* >::const_iterator range = ranges_.begin(); range != ranges_.end(); ++range) {
+    if ((*range)->connection_info->topic != topic || (*range)->begin == (*range)->end) continue;
+    if (found == decimators_.end()) { count += std::distance((*range)->begin, (*range)->end); continue; }
+    RangeCursor cursor = { (*range)->begin, (*range)->end };
+    queue.push(cursor);
+  }
+  if (found == decimators_.end()) return count;
+
+  // apply a copy of the decimator to the index entries of all ranges in time order
+  Decimator decimator = found->second;
+  decimator.reset();
+  while(!queue.empty()) {
+    RangeCursor cursor = queue.top();
+    queue.pop();
+    if (decimator(cursor.entry->time)) count++;
+    if (++cursor.entry != cursor.end) queue.push(cursor);
+  }
+  return count;
+}
+
+void View::addWindow(View& source, const ros::Time& begin, const ros::Time& end)
+{
+  // copy the queries of the source view, restricted to [begin, end]
+  std::map<const ::rosbag::BagQuery *, const ::rosbag::BagQuery *> bag_queries;
+  const std::vector<SeekRange>& index = source.seekRanges();
+  for(std::vector< ::rosbag::BagQuery* >::const_iterator it = source.::rosbag::View::queries_.begin(); it != source.::rosbag::View::queries_.end(); ++it) {
+    const ::rosbag::BagQuery *query = *it;
+    boost::function<bool(const ConnectionInfo *)> filter = query->query.getQuery();
+    ::rosbag::Query window(filter, std::max(begin, query->query.getStartTime()), std::min(end, query->query.getEndTime()));
+    ::rosbag::View::queries_.push_back(new ::rosbag::BagQuery(query->bag, window, query->bag_revision));
+    bag_queries[query] = ::rosbag::View::queries_.back();
+  }
+  queries_ = source.queries_;
+  reduce_overlap_ = source.reduce_overlap_;
+
+  // set up the ranges from the seek index of the source view instead of querying the bags again
+  for(std::vector<SeekRange>::const_iterator it = index.begin(); it != index.end(); ++it) {
+    std::size_t first = std::lower_bound(it->entries.begin(), it->entries.end(), begin, IndexTimeCompare()) - it->entries.begin();
+    std::size_t last  = std::upper_bound(it->entries.begin(), it->entries.end(), end, IndexTimeCompare()) - it->entries.begin();
+    ranges_.push_back(new ::rosbag::MessageRange(
+                        first < it->entries.size() ? it->entries[first] : it->range->end,
+                        last  < it->entries.size() ? it->entries[last]  : it->range->end,
+                        it->range->connection_info, bag_queries[it->range->bag_query]));
+  }
+  view_revision_++;
+}
+
 void View::increment() {
   message_instance_.reset();
   if (eof_) return;
@@ -107,9 +395,15 @@ void View::increment() {
   if (!valid()) {
     start();
 
+  // or evaluate the message that next() stopped at the end of a time window
+  } else if (pending_) {
+    pending_ = false;
+    skipRejected();
+
   // or increment iterator
   } else {
     current_++;
+    skipRejected();
   }
 
   if (!valid()) eof_ = true;
@@ -146,31 +440,208 @@ void View::get(int nlhs, mxArray *plhs[], int nrhs, const mxArray *prhs[])
 
 void View::next(int nlhs, mxArray *plhs[], int nrhs, const mxArray *prhs[])
 {
+  // next(N) converts up to N messages at once
+  if (nrhs > 0 && Options::isScalar(prhs[0]) && mxIsNumeric(prhs[0])) {
+    double count = Options::getDoubleScalar(prhs[0]);
+    if (count < 0) throw Exception("View.next", "number of messages must not be negative");
+    next(nlhs, plhs, static_cast<std::size_t>(count));
+    return;
+  }
+
+  // next('count', N, 'duration', d) converts the messages of the next d seconds, but at most N
+  if (nrhs > 0 && Options::isString(prhs[0])) {
+    Options options(nrhs, prhs, true);
+    double count = options.getDouble("count", std::numeric_limits<double>::infinity());
+    double duration = options.getDouble("duration");
+    options.throwOnUnused();
+    if (count < 0 || duration < 0) throw Exception("View.next", "count and duration must not be negative");
+    next(nlhs, plhs, count < std::numeric_limits<std::size_t>::max() ? static_cast<std::size_t>(count) : std::numeric_limits<std::size_t>::max(), ros::Duration(duration));
+    return;
+  }
+
   increment();
   if (nlhs > 0) get(nlhs, plhs, nrhs, prhs);
 }
 
+void View::next(int nlhs, mxArray *plhs[], std::size_t count, const ros::Duration& duration)
+{
+  std::map<std::string, FieldInfo> topics;
+  addFields(topics);
+
+  // count the messages per topic on a copy of the iterator (index only)
+  std::size_t n = 0;
+  ros::Time until = ros::TIME_MAX;
+  iterator it = end();
+  if (!eof_) {
+    it = current_;
+    if (!valid()) { it = begin(); resetFilters(); } else if (!pending_) ++it;
+    std::map<std::string, Decimator> decimators = decimators_;
+    if (!duration.isZero() && it != end()) until = it->getTime() + duration;
+    for(; n < count && it != end(); ++it) {
+      if (it->getTime() > until) break;
+      std::map<std::string, Decimator>::iterator decimator = decimators.find(it->getTopic());
+      if (decimator != decimators.end() && !decimator->second(it->getTime())) continue;
+      std::map<std::string, FieldInfo>::iterator field = topics.find(it->getTopic());
+      if (field != topics.end()) field->second.size++;
+      n++;
+    }
+  }
+  // (predicates can only reject messages, so the counts per topic are upper bounds and shrink() drops the rest)
+
+  // convert, predicates may reject some of the counted messages, but increment() must not evaluate any after them
+  bound_ = it;
+
+  // if no counted message passes the decimators, move past the window (or to the end of the view)
+  if (n == 0 && count > 0 && !eof_) {
+    increment();
+    if (valid() && current_ == bound_) pending_ = true;
+  }
+
+  // map connection headers to connection ids (MessageInstance does not expose its connection)
+  std::map<const void *, uint32_t> connection_ids;
+  std::vector<const ConnectionInfo *> connections = ::rosbag::View::getConnections();
+  for(std::vector<const ConnectionInfo *>::const_iterator it = connections.begin(); it != connections.end(); ++it) {
+    connection_ids[(*it)->header.get()] = (*it)->id;
+  }
+
+  mxArray *data = createStruct(topics);
+  mxArray *time = mxCreateDoubleMatrix(n, 1, mxREAL);
+  mxArray *topic = mxCreateNumericMatrix(n, 1, mxUINT32_CLASS, mxREAL);
+  mxArray *connection_id = mxCreateNumericMatrix(n, 1, mxUINT32_CLASS, mxREAL);
+
+  std::size_t i = 0;
+  for(; i < n; ++i) {
+    increment();
+    if (!valid()) break;
+    if (current_ == bound_) { pending_ = true; break; }
+
+    mxGetPr(time)[i] = current_->getTime().toSec();
+    std::map<const void *, uint32_t>::const_iterator id = connection_ids.find(current_->getConnectionHeader().get());
+    static_cast<uint32_T *>(mxGetData(connection_id))[i] = (id != connection_ids.end()) ? id->second : std::numeric_limits<uint32_t>::max();
+
+    std::map<std::string, FieldInfo>::iterator it = topics.find(current_->getTopic());
+    if (it == topics.end()) continue;
+    FieldInfo &field = it->second;
+    static_cast<uint32_T *>(mxGetData(topic))[i] = field.fieldnum + 1;
+
+    mxArray *target = mxGetFieldByNumber(data, 0, field.fieldnum);
+    target = getInternal(target, field.index++, field.size);
+    mxSetFieldByNumber(data, 0, field.fieldnum, target);
+  }
+
+  bound_ = end();
+
+  // drop the messages that were reserved for but rejected by a predicate
+  shrink(data, topics);
+  if (i < n) {
+    mxSetM(time, i);
+    mxSetM(topic, i);
+    mxSetM(connection_id, i);
+  }
+
+  plhs[0] = data;
+  if (nlhs > 1) {
+    static const char *fieldnames[] = { "Time", "Topic", "ConnectionId", "Topics", "Progress" };
+    mxArray *info = mxCreateStructMatrix(1, 1, 5, fieldnames);
+    mxSetField(info, 0, "Time", time);
+    mxSetField(info, 0, "Topic", topic);
+    mxSetField(info, 0, "ConnectionId", connection_id);
+
+    // fraction of the time range of this view up to the last returned message
+    double progress = 1.0;
+    if (valid()) {
+      ros::Time begin = ::rosbag::View::getBeginTime(), end = ::rosbag::View::getEndTime();
+      if (end > begin) progress = (current_->getTime() - begin).toSec() / (end - begin).toSec();
+    }
+    mxSetField(info, 0, "Progress", mxCreateDoubleScalar(progress));
+
+    mxArray *names = mxCreateCellMatrix(1, topics.size());
+    for(std::map<std::string, FieldInfo>::const_iterator it = topics.begin(); it != topics.end(); ++it) {
+      mxSetCell(names, it->second.fieldnum, mxCreateString(it->first.c_str()));
+    }
+    mxSetField(info, 0, "Topics", names);
+    plhs[1] = info;
+  } else {
+    mxDestroyArray(time);
+    mxDestroyArray(topic);
+    mxDestroyArray(connection_id);
+  }
+}
+
+namespace {
+  // reduces a converted topic from size to the first used messages
+  void shrinkArray(mxArray *array, std::size_t used, std::size_t size)
+  {
+    if (!array || used == size) return;
+
+    // extended structs hold all messages in a single struct
+    if (mxIsStruct(array) && mxGetNumberOfElements(array) == 1 && mxGetFieldNumber(array, "count") >= 0 && mxGetFieldNumber(array, "string_fields") >= 0) {
+      mxDestroyArray(mxGetField(array, 0, "count"));
+      mxSetField(array, 0, "count", mxCreateDoubleScalar(used));
+      shrinkArray(mxGetField(array, 0, "stamps"), used, size);
+      shrinkArray(mxGetField(array, 0, "data"), used, size);
+      shrinkArray(mxGetField(array, 0, "strings"), used, size);
+      return;
+    }
+
+    // otherwise messages are stored in columns
+    if (mxGetN(array) == size) mxSetN(array, used);
+  }
+}
+
+void View::shrink(mxArray *data, const std::map<std::string, FieldInfo>& topics)
+{
+  for(std::map<std::string, FieldInfo>::const_iterator it = topics.begin(); it != topics.end(); ++it) {
+    if (it->second.index >= it->second.size) continue;
+    shrinkArray(mxGetFieldByNumber(data, 0, it->second.fieldnum), it->second.index, it->second.size);
+  }
+}
+
+void View::addFields(std::map<std::string, FieldInfo>& topics)
+{
+  // extract topic information from Connections
+  std::vector<const ConnectionInfo *> connections = ::rosbag::View::getConnections();
+  for(std::vector<const ConnectionInfo *>::iterator it = connections.begin(); it != connections.end(); ++it) {
+    const ConnectionInfo *c = *it;
+    if (topics.count(c->topic)) continue;
+    FieldInfo field;
+    field.topic = c->topic;
+    field.name = c->topic;
+    boost::algorithm::replace_all(field.name, "/", "_");
+    if (field.name.at(0) == '_') field.name = field.name.substr(1);
+    field.fieldnum = topics.size();
+    field.index = 0;
+    field.size = 0;
+    field.count = 0;
+    field.offset = 0;
+    field.part = 0;
+    topics[c->topic] = field;
+  }
+}
+
+mxArray *View::createStruct(const std::map<std::string, FieldInfo>& topics)
+{
+  std::vector<const char *> fieldnames(topics.size());
+  for(std::map<std::string, FieldInfo>::const_iterator it = topics.begin(); it != topics.end(); ++it) {
+    fieldnames[it->second.fieldnum] = it->second.name.c_str();
+  }
+  return mxCreateStructMatrix(1, 1, fieldnames.size(), fieldnames.data());
+}
+
 mxArray *View::getInternal(mxArray *target, std::size_t index, std::size_t size)
 {
    // go to the first entry if the current iterator is not valid
   if (!valid()) increment();
 
   // introspect message
+  DynamicDecoderPtr decoder;
   if (valid() && !message_instance_) {
-    MessagePtr introspection = messageByMD5Sum(current_->getMD5Sum());
-    if (introspection) {
-      // copy the serialized message to the read buffer (ugly)
-      std::size_t size = current_->size();
-      if (read_buffer_.size() < size) read_buffer_.resize(size);
-      ros::serialization::OStream ostream(read_buffer_.data(), read_buffer_.size());
-      current_->write(ostream);
-
-      // deserialize message
-      ros::serialization::IStream istream(read_buffer_.data(), size);
-      VoidPtr msg = introspection->deserialize(istream);
-      if (!msg) ROSMATLAB_WARN("deserialization of a message of type %s failed", current_->getDataType().c_str());
-
-      message_instance_ = introspection->introspect(msg);
+    if (introspect(current_->getMD5Sum())) {
+      // deserialize message directly from the bag's read buffer
+      boost::shared_ptr<MessageSpan> span = current_->instantiate<MessageSpan>();
+      message_instance_ = deserialize(*span);
+    } else if ((decoder = dynamicDecoder(current_->getDataType(), current_->getMD5Sum(), current_->getMessageDefinition()))) {
+      return decoder->toMatlab(*current_->instantiate<MessageSpan>(), target, index, size);
     } else {
       ROSMATLAB_PRINTF("Unknown data type '%s' in bag file", current_->getDataType().c_str());
       // throw UnknownDataTypeException(current_->getDataType());
@@ -187,68 +658,670 @@ mxArray *View::getInternal(mxArray *target, std::size_t index, std::size_t size)
   return target;
 }
 
-namespace {
-  struct FieldInfo {
-    std::string topic;
-    std::string name;
-    int fieldnum;
-    std::size_t index;
-    std::size_t size;
-  };
+const MessagePtr& View::introspect(const std::string& md5sum)
+{
+  // reuse the introspection and the message instance as long as the type does not change
+  if (!introspection_ || md5sum != introspection_->getMD5Sum()) {
+    introspection_ = messageByMD5Sum(md5sum);
+    instance_.reset();
+  }
+  return introspection_;
+}
+
+DynamicDecoderPtr View::dynamicDecoder(const std::string& datatype, const std::string& md5sum, const std::string& definition)
+{
+  // datatypes without introspection are decoded from the definition in the bag
+  try {
+    return DynamicDecoder::get(datatype, md5sum, definition);
+  } catch(Exception& e) {
+    ROSMATLAB_WARN("%s", e.what());
+    return DynamicDecoderPtr();
+  }
+}
+
+MessagePtr View::deserialize(const MessageSpan& span)
+{
+  if (!introspection_) return MessagePtr();
+  if (!instance_) instance_ = introspection_->createInstance();
+
+  ros::serialization::IStream istream(span.data, span.size);
+  VoidPtr msg = introspection_->deserialize(istream, instance_);
+  if (!msg) {
+    ROSMATLAB_WARN("deserialization of a message of type %s failed", introspection_->getDataType());
+    return MessagePtr();
+  }
+
+  return introspection_->introspect(msg);
+}
+
+View::DataOptions::DataOptions()
+  : threads(1)
+  , cache(false)
+{
+}
+
+View::DataOptions::DataOptions(const Options& options)
+  : threads(1)
+  , cache(false)
+{
+  if (options.hasKey("threads")) threads = options.getInteger("threads");
+  if (threads < 0) throw ArgumentException("View.data", "threads must not be negative");
+  if (options.hasKey("cache")) cache = options.getBool("cache");
+  decimator = Decimator::fromOptions(options);
 }
 
 void View::data(int nlhs, mxArray *plhs[], int nrhs, const mxArray *prhs[])
 {
-  std::vector<const ConnectionInfo *> connections = ::rosbag::View::getConnections();
+  Options options(nrhs, prhs, true);
+  DataOptions data_options(options);
+  options.throwOnUnused();
+  data(nlhs, plhs, data_options);
+}
 
-  // extract topic information from Connections
+// Gives data() and save() filters of their own, configured with the decimation of their options, and restores
+// the filters of the cursor and its deserialized message when they return or throw
+class View::DataScope {
+public:
+  DataScope(View& view, const Decimator& decimation)
+    : view_(view)
+    , decimation_(view.decimation_)
+    , decimators_(view.decimators_)
+    , predicates_(view.predicates_)
+    , introspection_(view.introspection_)
+    , instance_(view.instance_)
+    , message_instance_(view.message_instance_)
+  {
+    // the message of the cursor must not be overwritten by deserialize()
+    view_.instance_.reset();
+    view_.decimation_ = decimation;
+    view_.resetFilters();
+  }
+
+  ~DataScope()
+  {
+    view_.decimation_ = decimation_;
+    view_.decimators_.swap(decimators_);
+    view_.predicates_.swap(predicates_);
+    view_.introspection_ = introspection_;
+    view_.instance_ = instance_;
+    view_.message_instance_ = message_instance_;
+  }
+
+private:
+  View& view_;
+  Decimator decimation_;
+  std::map<std::string, Decimator> decimators_;
+  std::map<std::string, PredicatePtr> predicates_;
+  MessagePtr introspection_;
+  VoidPtr instance_;
+  MessagePtr message_instance_;
+};
+
+void View::data(int nlhs, mxArray *plhs[], const DataOptions& options)
+{
   std::map<std::string, FieldInfo> topics;
-  std::vector<const char *> fieldnames;
-  fieldnames.reserve(connections.size());
+  addFields(topics);
+  DataScope scope(*this, options.decimator);
+  countMessages(topics);
 
-  for(std::vector<const ConnectionInfo *>::iterator it = connections.begin(); it != connections.end(); ++it) {
-    const ConnectionInfo *c = *it;
-    FieldInfo field;
-    field.topic = c->topic;
-    field.name = c->topic;
-    boost::algorithm::replace_all(field.name, "/", "_");
-    if (field.name.at(0) == '_') field.name = field.name.substr(1);
-    fieldnames.push_back(field.name.c_str());
-    field.fieldnum = topics.size();
+  plhs[0] = convert(topics, options);
+}
+
+View::SaveOptions::SaveOptions(const Options& options)
+  : DataOptions(options)
+  , batch(1000000)
+  , mode("w7.3")
+{
+  if (options.hasKey("batch")) batch = std::max(options.getInteger("batch"), 1);
+  std::string version = options.getString("version", "7.3");
+  if (version == "7") mode = "wz";
+  else if (version == "6") mode = "w";
+  else if (version != "7.3") throw Exception("View.save", "version must be '7.3', '7' or '6'");
+}
+
+void View::save(int nrhs, const mxArray *prhs[])
+{
+  if (nrhs < 1) throw ArgumentException("View.save", 1);
+  std::string filename = Options::getString(prhs[0]);
+  Options options(nrhs - 1, prhs + 1, true);
+  SaveOptions save_options(options);
+  options.throwOnUnused();
+  save(filename, save_options);
+}
+
+namespace {
+  class MatFile {
+  public:
+    MatFile(const std::string& filename, const std::string& mode) : filename_(filename), file_(matOpen(filename.c_str(), mode.c_str())) {
+      if (!file_) throw Exception("View.save", "could not open " + filename + " for writing");
+    }
+    ~MatFile() { if (file_) matClose(file_); }
+
+    void put(const std::string& name, const mxArray *value) {
+      if (matPutVariable(file_, name.c_str(), value) != 0) throw Exception("View.save", "could not write variable " + name + " to " + filename_);
+    }
+    void close() {
+      MATFile *file = file_;
+      file_ = 0;
+      if (matClose(file) != 0) throw Exception("View.save", "could not close " + filename_);
+    }
+
+  private:
+    std::string filename_;
+    MATFile *file_;
+  };
+}
+
+// Writes the converted arrays of save() to the MAT-file. Topics with more messages than their share of the batch
+// are written in parts as variables name_1, name_2, ..., as a MAT-file variable cannot be appended to.
+class View::PartWriter {
+public:
+  PartWriter(View& view, MatFile& file) : view_(view), file_(file) { view_.writer_ = this; }
+  ~PartWriter() { view_.writer_ = 0; }
+
+  void flush(mxArray *data, FieldInfo& field)
+  {
+    mxArray *value = mxGetFieldByNumber(data, 0, field.fieldnum);
+    if (value) {
+      bool split = field.size < field.count;
+      file_.put(split ? field.name + "_" + boost::lexical_cast<std::string>(++field.part) : field.name, value);
+      mxDestroyArray(value);
+      mxSetFieldByNumber(data, 0, field.fieldnum, 0);
+    }
+
+    // the next part has the same size, except for the last one
+    field.offset += field.index;
     field.index = 0;
-    field.size = 0;
-    topics[c->topic] = field;
+    field.size = std::min(field.size, field.count - std::min(field.offset, field.count));
+  }
+
+private:
+  View& view_;
+  MatFile& file_;
+};
+
+void View::save(const std::string& filename, const SaveOptions& options)
+{
+  std::map<std::string, FieldInfo> topics;
+  addFields(topics);
+  DataScope scope(*this, options.decimator);
+  countMessages(topics);
+
+  // the view is read once and every topic is allocated a share of options.batch in proportion to its number of
+  // messages, so that load(filename) returns the struct of data() if the whole view fits into one batch
+  std::size_t total = 0;
+  for(std::map<std::string, FieldInfo>::const_iterator it = topics.begin(); it != topics.end(); ++it) total += it->second.count;
+  if (total > options.batch) {
+    for(std::map<std::string, FieldInfo>::iterator it = topics.begin(); it != topics.end(); ++it) {
+      if (it->second.count == 0) continue;
+      std::size_t share = static_cast<std::size_t>(static_cast<double>(it->second.count) * options.batch / total);
+      it->second.size = std::min(it->second.count, std::max<std::size_t>(share, 1));
+    }
+  }
+
+  MatFile file(filename, options.mode);
+  PartWriter writer(*this, file);
+
+  // convert() removes the topics served from the cache from its argument
+  std::map<std::string, FieldInfo> remaining(topics);
+  mxArray *data = convert(remaining, options);
+  for(std::map<std::string, FieldInfo>::iterator it = topics.begin(); it != topics.end(); ++it) {
+    std::map<std::string, FieldInfo>::iterator field = remaining.find(it->first);
+    writer.flush(data, field != remaining.end() ? field->second : it->second);
+  }
+  mxDestroyArray(data);
+  file.close();
+}
+
+void View::countMessages(std::map<std::string, FieldInfo>& topics)
+{
+  // count the messages per topic in a single pass over the index ranges of this view
+  // (views are never constructed with reduce_overlap, so messages matched by several queries are returned and counted for each)
+  for(std::vector< ::rosbag::MessageRange* >::const_iterator range = ranges_.begin(); range != ranges_.end(); ++range) {
+    std::map<std::string, FieldInfo>::iterator field = topics.find((*range)->connection_info->topic);
+    if (field == topics.end()) continue;
+    if (decimators_.count(field->first)) continue;
+    field->second.size += std::distance((*range)->begin, (*range)->end);
+  }
+
+  // decimated topics are counted on their index entries
+  for(std::map<std::string, Decimator>::const_iterator it = decimators_.begin(); it != decimators_.end(); ++it) {
+    std::map<std::string, FieldInfo>::iterator field = topics.find(it->first);
+    if (field != topics.end()) field->second.size = countDecimated(it->first);
   }
 
+  for(std::map<std::string, FieldInfo>::iterator it = topics.begin(); it != topics.end(); ++it) it->second.count = it->second.size;
+}
+
+mxArray *View::convert(std::map<std::string, FieldInfo>& topics, const DataOptions& options)
+{
   // create result struct
-  mxArray *data = mxCreateStructMatrix(1, 1, fieldnames.size(), fieldnames.data());
+  mxArray *data = createStruct(topics);
 
-  // iterate through View
-  for(start(); valid(); increment()) {
-    if (!topics.count(current_->getTopic())) continue;
-    FieldInfo &field = topics[current_->getTopic()];
-    mxArray *target = mxGetFieldByNumber(data, 0, field.fieldnum);
+  // serve topics from the on-disk cache
+  boost::shared_ptr<Cache> cache;
+  std::map<std::string, std::string> cache_keys;
+  if (options.cache) cache = openCache();
+  if (cache) {
+    for(std::map<std::string, FieldInfo>::iterator it = topics.begin(); it != topics.end(); ) {
+      // topics split by save() are never held in memory as a whole
+      if (it->second.size < it->second.count) { ++it; continue; }
+      std::string key = cache->key(cacheKey(it->second));
+      mxArray *cached = cache->read(it->first, key);
+      if (cached) {
+        mxSetFieldByNumber(data, 0, it->second.fieldnum, cached);
+        topics.erase(it++);
+        continue;
+      }
+      cache_keys[it->first] = key;
+      ++it;
+    }
+  }
+
+  // read the remaining topics
+  if (!topics.empty()) {
+    if (options.threads != 1) {
+      dataParallel(data, topics, options.threads);
+    } else if (!dataMapped(data, topics) && !dataMerged(data, topics)) {
+      dataSequential(data, topics);
+    }
+  }
+
+  // topics filtered by a predicate were sized for all messages
+  shrink(data, topics);
 
-    if (!target) {
-      // find out how many messages are in the bag file by iterating over all (rosbag::Queries) and adding a new TopicFilterQuery object for each
-      ::rosbag::View only_this_topic(reduce_overlap_);
-      for(std::vector< ::rosbag::BagQuery* >::iterator query = ::rosbag::View::queries_.begin(); query != ::rosbag::View::queries_.end(); ++query) {
-        only_this_topic.addQuery(*((*query)->bag), TopicFilterQuery((*query)->query, current_->getTopic()));
+  // store the converted topics in the cache
+  if (cache) {
+    for(std::map<std::string, FieldInfo>::const_iterator it = topics.begin(); it != topics.end(); ++it) {
+      if (!cache_keys.count(it->first)) continue;
+      if (!cache->write(it->first, cache_keys[it->first], mxGetFieldByNumber(data, 0, it->second.fieldnum))) {
+        ROSMATLAB_WARN("Could not write topic %s to the cache", it->first.c_str());
       }
-      field.size = only_this_topic.size();
-      // ROSMATLAB_PRINTF("Field %s has %u entries.", field.name.c_str(), field.size);
     }
+  }
 
-    assert(field.index < field.size);
-    // ROSMATLAB_PRINTF("Converting entry %u/%u of field %s", field.index, field.size, field.name.c_str());
-    target = getInternal(target, field.index++, field.size);
-//    if (!target) target = mxCreateDoubleScalar(field.size); // debugging only
+  return data;
+}
 
-    mxSetFieldByNumber(data, 0, field.fieldnum, target);
+namespace {
+  struct ResampledTopic {
+    std::size_t signal;
+    std::vector<FieldPath> paths;
+    std::vector<std::size_t> columns;
+  };
+}
+
+void View::resample(int nlhs, mxArray *plhs[], int nrhs, const mxArray *prhs[])
+{
+  if (nrhs < 2) throw ArgumentException("View.resample", 2);
+
+  // fields are given as topic.path, e.g. /odom.pose.pose.position.x
+  std::vector<std::string> names;
+  if (Options::isString(prhs[1])) {
+    names.push_back(Options::getString(prhs[1]));
+  } else if (mxIsCell(prhs[1])) {
+    for(std::size_t i = 0; i < mxGetNumberOfElements(prhs[1]); ++i) {
+      const mxArray *cell = mxGetCell(prhs[1], i);
+      if (!cell || !Options::isString(cell)) throw Exception("View.resample", "fields must be a string or a cell array of strings");
+      names.push_back(Options::getString(cell));
+    }
+  } else {
+    throw Exception("View.resample", "fields must be a string or a cell array of strings");
   }
 
-  // return result
-  plhs[0] = data;
+  Options options(nrhs - 2, prhs + 2, true);
+  std::string method = options.getString("method", "linear");
+  std::string stamps = options.getString("time", "record");
+  options.throwOnUnused();
+  if (method != "linear" && method != "zoh") throw Exception("View.resample", "method must be 'linear' or 'zoh'");
+  if (stamps != "record" && stamps != "header") throw Exception("View.resample", "time must be 'record' or 'header'");
+
+  // a scalar is a rate, the grid then spans the time range of this view
+  if (!mxIsDouble(prhs[0]) || mxIsComplex(prhs[0])) throw Exception("View.resample", "first argument must be a rate or a vector of times");
+  std::vector<double> grid;
+  if (mxGetNumberOfElements(prhs[0]) == 1) {
+    double rate = *mxGetPr(prhs[0]);
+    if (!(rate > 0)) throw Exception("View.resample", "rate must be positive");
+    ros::Time begin = ::rosbag::View::getBeginTime(), end = ::rosbag::View::getEndTime();
+    for(std::size_t i = 0; begin <= end && begin.toSec() + i / rate <= end.toSec(); ++i) grid.push_back(begin.toSec() + i / rate);
+  } else {
+    grid.assign(mxGetPr(prhs[0]), mxGetPr(prhs[0]) + mxGetNumberOfElements(prhs[0]));
+    if (std::adjacent_find(grid.begin(), grid.end(), std::greater<double>()) != grid.end()) throw Exception("View.resample", "times must be sorted");
+  }
+
+  mxArray *result = mxCreateDoubleMatrix(grid.size(), names.size(), mxREAL);
+  Resampler resampler(grid, names.size(), method == "zoh" ? Resampler::ZERO_ORDER_HOLD : Resampler::LINEAR, mxGetPr(result));
+
+  std::map<std::string, ResampledTopic> topics;
+  for(std::size_t i = 0; i < names.size(); ++i) {
+    std::string::size_type dot = names[i].find('.');
+    if (dot == std::string::npos) throw Exception("View.resample", "field " + names[i] + " has no topic");
+    std::string topic = names[i].substr(0, dot);
+    if (topic.empty() || topic[0] != '/') topic = "/" + topic;
+    topics[topic].paths.push_back(FieldPath(names[i].substr(dot + 1)));
+    topics[topic].columns.push_back(i);
+  }
+  for(std::map<std::string, ResampledTopic>::iterator it = topics.begin(); it != topics.end(); ++it) {
+    it->second.signal = resampler.addSignal(it->second.columns);
+  }
+
+  // stream the messages of the selected topics until every topic has passed the end of the grid
+  std::vector<double> values;
+  for(start(); valid() && !resampler.done(); increment()) {
+    std::map<std::string, ResampledTopic>::const_iterator it = topics.find(current_->getTopic());
+    if (it == topics.end()) continue;
+    const ResampledTopic &topic = it->second;
+
+    if (!message_instance_) {
+      if (!introspect(current_->getMD5Sum())) continue;
+      message_instance_ = deserialize(*current_->instantiate<MessageSpan>());
+      if (!message_instance_) continue;
+    }
+
+    double time = current_->getTime().toSec();
+    if (stamps == "header") {
+      if (!message_instance_->hasHeader()) throw Exception("View.resample", "messages on topic " + it->first + " have no header");
+      time = message_instance_->getHeader(message_instance_->getConstInstance())->stamp.toSec();
+    }
+
+    values.resize(topic.paths.size());
+    for(std::size_t i = 0; i < topic.paths.size(); ++i) {
+      if (!topic.paths[i].getDouble(message_instance_, values[i])) values[i] = std::numeric_limits<double>::quiet_NaN();
+    }
+    resampler.add(topic.signal, time, values);
+  }
+  resampler.finish();
+
+  // leave the view in the same state as after a complete iteration
+  current_ = end();
+  eof_ = true;
+  message_instance_.reset();
+
+  plhs[0] = result;
+  if (nlhs > 1) {
+    plhs[1] = mxCreateDoubleMatrix(grid.size(), 1, mxREAL);
+    std::copy(grid.begin(), grid.end(), mxGetPr(plhs[1]));
+  }
+}
+
+namespace {
+  struct MappedCursor {
+    std::multiset< ::rosbag::IndexEntry>::const_iterator entry;
+    const ::rosbag::MessageRange *range;
+    const MappedFile *mapping;
+
+    bool operator<(const MappedCursor& other) const { return entry->time > other.entry->time; }
+  };
+}
+
+// A message found by one of the readers of data(), read and deserialized only after the decimator accepted it
+struct View::MessageSource {
+  virtual ~MessageSource() {}
+  virtual MessagePtr message() = 0;                      //!< The deserialized message, if its datatype has introspection
+  virtual DynamicDecoderPtr decoder(MessageSpan& span) = 0;  //!< Otherwise a decoder and the serialized message in span
+};
+
+// messages deserialized by the worker threads of ParallelReader and MergedReader
+struct View::EntrySource : public View::MessageSource {
+  EntrySource(ParallelReader::Entry& entry) : entry_(entry) {}
+  MessagePtr message() {
+    if (!entry_.introspection || !entry_.instance) return MessagePtr();
+    return entry_.introspection->introspect(entry_.instance);
+  }
+  DynamicDecoderPtr decoder(MessageSpan& span) {
+    span = MessageSpan(entry_.buffer.data(), entry_.buffer.size());
+    return entry_.decoder;
+  }
+  ParallelReader::Entry& entry_;
+};
+
+// messages read by an iterator of the view
+struct View::InstanceSource : public View::MessageSource {
+  InstanceSource(View& view, MessageInstance& instance) : view_(view), instance_(instance) {}
+  MessagePtr message() {
+    if (!view_.introspect(instance_.getMD5Sum())) return MessagePtr();
+    return view_.deserialize(*instance_.instantiate<MessageSpan>());
+  }
+  DynamicDecoderPtr decoder(MessageSpan& span) {
+    DynamicDecoderPtr decoder = view_.dynamicDecoder(instance_.getDataType(), instance_.getMD5Sum(), instance_.getMessageDefinition());
+    if (decoder) span = *instance_.instantiate<MessageSpan>();
+    return decoder;
+  }
+  View& view_;
+  MessageInstance& instance_;
+};
+
+// messages in the uncompressed chunks of a memory-mapped bag
+struct View::MappedSource : public View::MessageSource {
+  MappedSource(View& view, const MappedCursor& cursor) : view_(view), cursor_(cursor) {}
+  MessagePtr message() {
+    MessageSpan span;
+    if (!view_.introspect(cursor_.range->connection_info->md5sum) || !cursor_.mapping->span(*cursor_.entry, span)) return MessagePtr();
+    return view_.deserialize(span);
+  }
+  DynamicDecoderPtr decoder(MessageSpan& span) {
+    const ConnectionInfo *connection = cursor_.range->connection_info;
+    DynamicDecoderPtr decoder = view_.dynamicDecoder(connection->datatype, connection->md5sum, connection->msg_def);
+    if (!decoder || !cursor_.mapping->span(*cursor_.entry, span)) return DynamicDecoderPtr();
+    return decoder;
+  }
+  View& view_;
+  const MappedCursor& cursor_;
+};
+
+void View::addMessage(mxArray *data, FieldInfo& field, const ros::Time& time, MessageSource& source)
+{
+  // the full part of a topic split by save() is written before the next message is converted
+  if (field.index >= field.size) {
+    if (!writer_ || field.size == field.count) return;
+    writer_->flush(data, field);
+    if (field.size == 0) return;
+  }
+
+  // messages rejected by the decimator are never read
+  std::map<std::string, Decimator>::iterator decimator = decimators_.find(field.topic);
+  if (decimator != decimators_.end() && !decimator->second(time)) return;
+
+  // predicates need the deserialized message
+  MessagePtr message = source.message();
+  std::map<std::string, PredicatePtr>::const_iterator predicate = predicates_.find(field.topic);
+  if (predicate != predicates_.end() && (!message || !(*predicate->second)(message))) return;
+
+  mxArray *target = mxGetFieldByNumber(data, 0, field.fieldnum);
+  MessageSpan span;
+  DynamicDecoderPtr decoder;
+  if (message) {
+    target = Conversion(message).toMatlab(target, field.index++, field.size);
+  } else if ((decoder = source.decoder(span))) {
+    target = decoder->toMatlab(span, target, field.index++, field.size);
+  } else if (!target) {
+    ROSMATLAB_PRINTF("Unknown data type in bag file for topic %s", field.topic.c_str());
+    target = mxCreateStructMatrix(0, 0, 0, 0);
+  }
+  mxSetFieldByNumber(data, 0, field.fieldnum, target);
+}
+
+void View::dataParallel(mxArray *data, std::map<std::string, FieldInfo>& topics, int threads)
+{
+  // read and deserialize in parallel, convert every slice in the Matlab thread as soon as it is done
+  ParallelReader reader(threads);
+  for(std::vector< ::rosbag::BagQuery* >::const_iterator query = ::rosbag::View::queries_.begin(); query != ::rosbag::View::queries_.end(); ++query) {
+    reader.addQuery((*query)->bag->getFileName(), (*query)->query);
+  }
+  std::vector<const ConnectionInfo *> connections = ::rosbag::View::getConnections();
+  for(std::vector<const ConnectionInfo *>::iterator it = connections.begin(); it != connections.end(); ++it) {
+    if (topics.count((*it)->topic)) reader.addConnection(*it);
+  }
+
+  // the slices start at chunk boundaries, taken from the first index entry of every chunk
+  update();
+  std::map<std::pair<const ::rosbag::Bag *, uint64_t>, ros::Time> chunk_starts;
+  for(std::vector< ::rosbag::MessageRange* >::const_iterator range = ranges_.begin(); range != ranges_.end(); ++range) {
+    if (!topics.count((*range)->connection_info->topic)) continue;
+    uint64_t chunk_pos = std::numeric_limits<uint64_t>::max();
+    for(IndexIterator entry = (*range)->begin; entry != (*range)->end; ++entry) {
+      if (entry->chunk_pos == chunk_pos) continue;
+      chunk_pos = entry->chunk_pos;
+      std::pair<const ::rosbag::Bag *, uint64_t> key((*range)->bag_query->bag, chunk_pos);
+      std::map<std::pair<const ::rosbag::Bag *, uint64_t>, ros::Time>::iterator found = chunk_starts.find(key);
+      if (found == chunk_starts.end()) chunk_starts[key] = entry->time;
+      else found->second = std::min(found->second, entry->time);
+    }
+  }
+  std::vector<ros::Time> chunks;
+  for(std::map<std::pair<const ::rosbag::Bag *, uint64_t>, ros::Time>::const_iterator it = chunk_starts.begin(); it != chunk_starts.end(); ++it) {
+    chunks.push_back(it->second);
+  }
+  reader.read(::rosbag::View::getBeginTime(), ::rosbag::View::getEndTime(), chunks);
+
+  ParallelReader::Entries slice;
+  while(reader.next(slice)) {
+    for(ParallelReader::Entries::iterator entry = slice.begin(); entry != slice.end(); ++entry) {
+      std::map<std::string, FieldInfo>::iterator it = topics.find(entry->topic);
+      if (it == topics.end()) continue;
+      EntrySource source(*entry);
+      addMessage(data, it->second, entry->time, source);
+
+      // release the message as soon as it is converted
+      entry->instance.reset();
+      entry->buffer.clear();
+    }
+  }
+}
+
+bool View::dataMerged(mxArray *data, std::map<std::string, FieldInfo>& topics)
+{
+  // views on multiple bag files read every bag in its own thread
+  update();
+  MergedReader reader;
+  for(std::vector< ::rosbag::BagQuery* >::const_iterator query = ::rosbag::View::queries_.begin(); query != ::rosbag::View::queries_.end(); ++query) {
+    ros::Time begin = ros::TIME_MAX, end = ros::TIME_MIN;
+    for(std::vector< ::rosbag::MessageRange* >::const_iterator range = ranges_.begin(); range != ranges_.end(); ++range) {
+      if ((*range)->bag_query != *query || (*range)->begin == (*range)->end || !topics.count((*range)->connection_info->topic)) continue;
+      std::multiset< ::rosbag::IndexEntry>::const_iterator back = (*range)->end;
+      begin = std::min(begin, (*range)->begin->time);
+      end = std::max(end, (--back)->time);
+    }
+    if (begin <= end) reader.addQuery((*query)->bag->getFileName(), (*query)->query, begin, end);
+  }
+  if (reader.bags() < 2) return false;
+
+  std::vector<const ConnectionInfo *> connections = ::rosbag::View::getConnections();
+  for(std::vector<const ConnectionInfo *>::iterator it = connections.begin(); it != connections.end(); ++it) {
+    if (topics.count((*it)->topic)) reader.addConnection(*it);
+  }
+
+  MergedReader::Entry entry;
+  while(reader.next(entry)) {
+    std::map<std::string, FieldInfo>::iterator it = topics.find(entry.topic);
+    if (it == topics.end()) continue;
+    EntrySource source(entry);
+    addMessage(data, it->second, entry.time, source);
+  }
+
+  return true;
+}
+
+void View::dataSequential(mxArray *data, std::map<std::string, FieldInfo>& topics)
+{
+  // iterate through View with an iterator of its own, the cursor of next() is left alone
+  for(iterator it = begin(); it != end(); ++it) {
+    std::map<std::string, FieldInfo>::iterator field = topics.find(it->getTopic());
+    if (field == topics.end()) continue;
+    InstanceSource source(*this, *it);
+    addMessage(data, field->second, it->getTime(), source);
+  }
+}
+
+boost::shared_ptr<Cache> View::openCache()
+{
+  // the cache is stored next to the bag file, so all queries must refer to the same bag
+  std::string filename;
+  for(std::vector< ::rosbag::BagQuery* >::const_iterator query = ::rosbag::View::queries_.begin(); query != ::rosbag::View::queries_.end(); ++query) {
+    if (!filename.empty() && (*query)->bag->getFileName() != filename) {
+      ROSMATLAB_WARN("The cache is only supported for views on a single bag file");
+      return boost::shared_ptr<Cache>();
+    }
+    filename = (*query)->bag->getFileName();
+  }
+  if (filename.empty()) return boost::shared_ptr<Cache>();
+
+  try {
+    return boost::shared_ptr<Cache>(new Cache(filename));
+  } catch(Exception &e) {
+    ROSMATLAB_WARN("%s", e.what());
+    return boost::shared_ptr<Cache>();
+  }
+}
+
+std::string View::cacheKey(const FieldInfo& field)
+{
+  // the converted output of a topic depends on its message types, the selected messages and the conversion options
+  std::set<std::string> md5sums;
+  ros::Time first = ros::TIME_MAX, last = ros::TIME_MIN;
+  for(std::vector< ::rosbag::MessageRange* >::const_iterator range = ranges_.begin(); range != ranges_.end(); ++range) {
+    if ((*range)->connection_info->topic != field.topic || (*range)->begin == (*range)->end) continue;
+    md5sums.insert((*range)->connection_info->md5sum);
+    std::multiset< ::rosbag::IndexEntry>::const_iterator back = (*range)->end;
+    first = std::min(first, (*range)->begin->time);
+    last = std::max(last, (--back)->time);
+  }
+
+  std::ostringstream key;
+  key << "topic=" << field.topic << ";count=" << field.count << ";first=" << first << ";last=" << last;
+  std::map<std::string, Decimator>::const_iterator decimator = decimators_.find(field.topic);
+  if (decimator != decimators_.end()) key << ";" << decimator->second.toString();
+  std::map<std::string, PredicatePtr>::const_iterator predicate = predicates_.find(field.topic);
+  if (predicate != predicates_.end()) key << ";where=" << predicate->second->getExpression();
+  key << ";md5sum=";
+  for(std::set<std::string>::const_iterator md5sum = md5sums.begin(); md5sum != md5sums.end(); ++md5sum) {
+    ConversionOptions options(Conversion::defaultOptions());
+    MessagePtr introspection = messageByMD5Sum(*md5sum);
+    if (introspection) options.merge(Conversion::perMessageOptions(introspection));
+    key << *md5sum << "(" << options.conversionTypeString() << "," << options.addMetaData() << "," << options.addConnectionHeader() << ")";
+  }
+  return key.str();
+}
+
+bool View::dataMapped(mxArray *data, std::map<std::string, FieldInfo>& topics)
+{
+  // all messages of this view must be stored in uncompressed chunks of memory-mapped bags
+  update();
+  std::map<std::string, std::vector<MappedCursor> > cursors;
+  for(std::vector< ::rosbag::MessageRange* >::const_iterator range = ranges_.begin(); range != ranges_.end(); ++range) {
+    const MappedFile *mapping = static_cast<const Bag *>((*range)->bag_query->bag)->mapping();
+    if (!mapping) return false;
+
+    uint64_t chunk_pos = std::numeric_limits<uint64_t>::max();
+    for(std::multiset< ::rosbag::IndexEntry>::const_iterator entry = (*range)->begin; entry != (*range)->end; ++entry) {
+      if (entry->chunk_pos == chunk_pos) continue;
+      chunk_pos = entry->chunk_pos;
+      if (mapping->isCompressed(chunk_pos)) return false;
+    }
+
+    if ((*range)->begin == (*range)->end || !topics.count((*range)->connection_info->topic)) continue;
+    MappedCursor cursor;
+    cursor.entry = (*range)->begin;
+    cursor.range = *range;
+    cursor.mapping = mapping;
+    cursor.mapping->advise(MappedFile::SEQUENTIAL);
+    cursors[(*range)->connection_info->topic].push_back(cursor);
+  }
+
+  // merge the ranges of each topic in time order and convert the messages in place
+  for(std::map<std::string, std::vector<MappedCursor> >::iterator it = cursors.begin(); it != cursors.end(); ++it) {
+    FieldInfo &field = topics[it->first];
+    std::priority_queue<MappedCursor> queue(it->second.begin(), it->second.end());
+    while(!queue.empty()) {
+      MappedCursor cursor = queue.top();
+      queue.pop();
+      MappedSource source(*this, cursor);
+      addMessage(data, field, cursor.entry->time, source);
+      if (++cursor.entry != cursor.range->end) queue.push(cursor);
+    }
+  }
+
+  return true;
 }
 
 mxArray *View::getTime()